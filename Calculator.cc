@@ -0,0 +1,1004 @@
+#include "Calculator.hh"
+#include "Point.hh"
+#include "Polygon.hh"
+#include "Color.hh"
+#include "HalfPlane.hh"
+#include "HullBuilder.hh"
+#include "Expr.hh"
+#include "Join.hh"
+#include "PolygonSet.hh"
+#include "Renderer.hh"
+#include "Stats.hh"
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <new>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+using vp = vector <Point>;
+
+
+atomic <int> Session::count(0);
+
+
+/* Checks whether the input has a wrong number of arguments. */
+bool wrong_number(istringstream& iss, ostream& out) {
+    string s;
+    if (iss >> s) {
+        out << "error: command with wrong number of arguments";
+        return true;
+    }
+    return false;
+}
+
+
+/* Checks whether the input has an undefined polygon as an argument. */
+bool undef_id(map<string, Polygon>& Pols, const string& name, ostream& out) {
+    bool error = Pols.count(name) == 0;
+    if (error) out << "error: undefined polygon identifier";
+    return error;
+}
+
+
+/* Associates an identifier (name) with a convex polygon. */
+void Polygon_def(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    iss >> name;
+    string x_coord, y_coord;
+    vp V;
+    while (iss >> x_coord >> y_coord) {
+        double x = stod(x_coord), y = stod(y_coord);
+        Point P(x, y);
+        V.push_back(P);
+    }
+    //Obs: new polygons are black.
+    Pols[name] = Polygon(V);
+    out << "ok";
+}
+
+
+/* Associates an identifier (name) with the convex polygon formed by the
+   intersection of the half-planes a*x + b*y <= c given by their coefficients. */
+void Polygon_halfplanes(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        string a, b, c;
+        vector <HalfPlane> H;
+        while (iss >> a) {
+            if (not (iss >> b >> c)) {
+                out << "error: command with wrong number of arguments";
+                return;
+            }
+            HalfPlane h = {stod(a), stod(b), stod(c)};
+            H.push_back(h);
+        }
+        Pols[name] = Polygon(H);
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the name and the vertices of a given polygon. */
+void Polygon_print(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        // Check of possible errors.
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        out << name;
+        const vp& points = Pols[name].getPoints();
+        int n = points.size();
+        for (int i = 0; i < n; ++i) {
+            out << ' ' << points[i].getX() << ' ' << points[i].getY();
+        }
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Returns a snapshot of all the polygons, which is only built again when
+   some command may have changed them. */
+shared_ptr <const Snapshot> all_polygons(Calculator& calc) {
+    lock_guard <mutex> guard(calc.snapshot_lock);
+    long long version = calc.version;
+    if (not calc.snapshot or calc.snapshot->version != version) {
+        shared_ptr <Snapshot> S = make_shared <Snapshot>();
+        S->version = version;
+        for (const auto& e : calc.Pols) {
+            S->names.push_back(e.first);
+            S->set.add(e.second);
+        }
+        calc.snapshot = S;
+    }
+    return calc.snapshot;
+}
+
+
+/* Prints the area of the given polygon, or of all of them ("*"). */
+void Polygon_area(Calculator& calc, istringstream& iss, ostream& out) {
+    map<string, Polygon>& Pols = calc.Pols;
+    string name;
+    if (iss >> name) {
+        if (name == "*") {
+            if (wrong_number(iss, out)) return;
+            shared_ptr <const Snapshot> S = all_polygons(calc);
+            vector <double> areas = S->set.areas();
+            for (int i = 0; i < (int)S->names.size(); ++i) out << S->names[i] << ' ' << areas[i] << ' ';
+            return;
+        }
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        out << Pols[name].area();
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the perimeter of the given polygon, or of all of them ("*"). */
+void Polygon_perimeter(Calculator& calc, istringstream& iss, ostream& out) {
+    map<string, Polygon>& Pols = calc.Pols;
+    string name;
+    if (iss >> name) {
+        if (name == "*") {
+            if (wrong_number(iss, out)) return;
+            shared_ptr <const Snapshot> S = all_polygons(calc);
+            vector <double> perimeters = S->set.perimeters();
+            for (int i = 0; i < (int)S->names.size(); ++i) out << S->names[i] << ' ' << perimeters[i] << ' ';
+            return;
+        }
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        out << Pols[name].perimeter();
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the number of vertices of the given polygon. */
+void Polygon_vertices(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        out << Pols[name].vertices();
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the centroid of the given polygon, or of all of them ("*"). */
+void Polygon_centroid(Calculator& calc, istringstream& iss, ostream& out) {
+    map<string, Polygon>& Pols = calc.Pols;
+    string name;
+    if (iss >> name) {
+        if (name == "*") {
+            if (wrong_number(iss, out)) return;
+            shared_ptr <const Snapshot> S = all_polygons(calc);
+            vector <Point> centroids = S->set.centroids();
+            for (int i = 0; i < (int)S->names.size(); ++i) {
+                out << S->names[i] << ' ' << centroids[i].getX() << ' ' << centroids[i].getY() << ' ';
+            }
+            return;
+        }
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        Point G = Pols[name].centroid();
+        //double x = Pols[name].centroid().getX();
+        //double y = Pols[name].centroid().getY();
+        out << G.getX() << ' ' << G.getY();
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the number of edges of the given polygon. */
+void Polygon_edges(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        out << Pols[name].edges();
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints yes or not to tell whether the given polygon is regular. */
+void Polygon_regular(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        if (Pols[name].regular()) out << "yes";
+        else out << "not";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the width of the given polygon. */
+void Polygon_width(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        out << Pols[name].width();
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the height of the given polygon. */
+void Polygon_height(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        out << Pols[name].height();
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Prints the RGB color of the given polygon. */
+void Polygon_getcol(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        Color c = Pols[name].getcol();
+        out << "R: " << c.R << " G: " << c.G << " B: " << c.B;
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/*  Lists all polygon identifiers, lexycographically sorted. */
+void Polygon_list(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    if (wrong_number(iss, out)) return;
+    for (const auto& e : Pols) out << e.first << ' ';
+}
+
+
+/* Saves a list of polygons in a file. */
+void Polygon_save(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string file;
+    if (iss >> file) {
+        string name;
+        vector <string> input;
+        bool error = false;
+        while (iss >> name and not error) {
+            error = undef_id(Pols, name, out);
+            input.push_back(name);
+        }
+        if (error) return;
+        else {
+            ofstream f(file);
+            int m = input.size();
+            for (int i = 0; i < m; ++i) {
+                name = input[i]; 
+                f << name;
+                const vp& points = Pols[name].getPoints();
+                int n = points.size();
+                for (int i = 0; i < n; ++i) {
+                    f << ' ' << points[i].getX() << ' ' << points[i].getY();
+                }
+                f << endl;
+            }
+            f.close();
+            out << "ok";
+        }
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Loads the polygons stored in a file. */
+void Polygon_load(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string file;
+    if (iss >> file) {
+        ifstream f(file);
+        string line;
+        while (getline(f, line)) {
+            vp V;
+            istringstream iss(line);
+            string name, x_coord, y_coord;
+            iss >> name;
+            while (iss >> x_coord >> y_coord) {
+                double x = stod(x_coord), y = stod(y_coord);
+                Point P(x, y);
+                V.push_back(P);
+            }
+            //Color c = {0, 0, 0};
+            Pols.insert({name, Polygon(V)});
+        }
+        f.close();
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Associates an identifier with the convex hull of the points stored in a file,
+   streaming them from disk with bounded memory. An optional epsilon gives an
+   approximate hull that keeps O(1/epsilon) points. */
+void Polygon_hullfile(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name, file, eps;
+    if (iss >> name >> file) {
+        double epsilon = 0;
+        if (iss >> eps) {
+            if (wrong_number(iss, out)) return;
+            epsilon = stod(eps);
+            if (not (epsilon > 0)) {
+                out << "error: command with wrong type of arguments";
+                return;
+            }
+        }
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            out << "error: cannot open file";
+            return;
+        }
+        HullBuilder builder(1 << 16, epsilon);
+        bool ok = builder.add(fd);
+        close(fd);
+        if (not ok) {
+            out << "error: wrong file format";
+            return;
+        }
+        Pols[name] = builder.hull();
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Associates a color to the given polygon. */
+void Polygon_setcol(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name;
+    if (iss >> name) {
+        if (undef_id(Pols, name, out)) return;
+        string r, g, b;
+        if (iss >> r >> g >> b) {
+            if (wrong_number(iss, out)) return;
+            double R = stod(r), G = stod(g), B = stod(b);
+            if (R > 1 or G > 1 or B > 1 or R < 0 or G < 0 or B < 0) {
+                out << "error: command with wrong type of arguments";
+            } else {
+                Color c = {R, G, B};
+                Pols[name].setcol(c);
+                out << "ok";
+            }
+        } else {
+            out << "error: command with wrong number of arguments";  
+        }
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Draws a list of polygons in a PNG file, in the background (as a job of
+   the given client) if a renderer is given. */
+void Polygon_draw(map<string, Polygon>& Pols, Renderer* renderer, int client, istringstream& iss, ostream& out) {
+    string image;
+    if (iss >> image) {
+        vector <Polygon> input;
+        string name;
+        while (iss >> name) {
+            if (undef_id(Pols, name, out)) return;
+            if (Pols[name].vertices() == 0) {
+                out << "error: empty polygon";
+                return;
+            }
+            input.push_back(Pols[name]);
+        }
+        if (input.empty()) {
+            out << "error: command with wrong number of arguments";
+            return;
+        }
+        if (renderer) renderer->submit(client, image, input);
+        else Renderer::render(image, input);
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores the intersecion of two given polygons. */
+void Polygon_intersection(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2, p3;
+    if (iss >> p1 >> p2) {
+        if (undef_id(Pols, p2, out)) return;
+        if (iss >> p3) {
+            if (undef_id(Pols, p3, out)) return;
+            if (wrong_number(iss, out)) return;
+            Pols[p1] = Pols[p2].intersection(Pols[p3]);
+        } else {
+            if (undef_id(Pols, p1, out)) return;
+            Pols[p1] = Pols[p1].intersection(Pols[p2]);
+        }
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores the union of two given polygons. */
+void Polygon_union(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2, p3;
+    if (iss >> p1 >> p2) {
+        if (undef_id(Pols, p2, out)) return;
+        if (iss >> p3) {
+            if (undef_id(Pols, p3, out)) return;
+            if (wrong_number(iss, out)) return;
+            Pols[p1] = Pols[p2].union_(Pols[p3]);
+        } else {
+            if (undef_id(Pols, p1, out)) return;
+            Pols[p1] = Pols[p1].union_(Pols[p2]);
+        }
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores the Minkowski sum of two given polygons. */
+void Polygon_minkowski(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2, p3;
+    if (iss >> p1 >> p2) {
+        if (undef_id(Pols, p2, out)) return;
+        if (iss >> p3) {
+            if (undef_id(Pols, p3, out)) return;
+            if (wrong_number(iss, out)) return;
+            Pols[p1] = Pols[p2].minkowskiSum(Pols[p3]);
+        } else {
+            if (undef_id(Pols, p1, out)) return;
+            Pols[p1] = Pols[p1].minkowskiSum(Pols[p2]);
+        }
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores the Minkowski difference of two given polygons. */
+void Polygon_minkowskidiff(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2, p3;
+    if (iss >> p1 >> p2) {
+        if (undef_id(Pols, p2, out)) return;
+        if (iss >> p3) {
+            if (undef_id(Pols, p3, out)) return;
+            if (wrong_number(iss, out)) return;
+            Pols[p1] = Pols[p2].minkowskiDifference(Pols[p3]);
+        } else {
+            if (undef_id(Pols, p1, out)) return;
+            Pols[p1] = Pols[p1].minkowskiDifference(Pols[p2]);
+        }
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores the part of a given polygon inside an axis-aligned rectangle. */
+void Polygon_clip(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2;
+    string xmin, ymin, xmax, ymax;
+    if (iss >> p1 >> p2 >> xmin >> ymin >> xmax >> ymax) {
+        if (undef_id(Pols, p2, out)) return;
+        if (wrong_number(iss, out)) return;
+        Pols[p1] = Pols[p2].clipRect(stod(xmin), stod(ymin), stod(xmax), stod(ymax));
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores the part of a given polygon inside the half-plane a*x + b*y <= c. */
+void Polygon_cut(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2;
+    string a, b, c;
+    if (iss >> p1 >> p2 >> a >> b >> c) {
+        if (undef_id(Pols, p2, out)) return;
+        if (wrong_number(iss, out)) return;
+        HalfPlane h = {stod(a), stod(b), stod(c)};
+        Pols[p1] = Pols[p2].clip(h);
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Splits a given polygon into a grid of tiles, named prefix_i_j
+   (column i, row j). Empty tiles are not stored. */
+void Polygon_tiles(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string prefix, name;
+    string x0, y0, w, h, cols, rows;
+    if (iss >> prefix >> name >> x0 >> y0 >> w >> h >> cols >> rows) {
+        if (undef_id(Pols, name, out)) return;
+        if (wrong_number(iss, out)) return;
+        int c = stoi(cols), r = stoi(rows);
+        if (c <= 0 or r <= 0 or (long long)c*r > INT_MAX or stod(w) <= 0 or stod(h) <= 0) {
+            out << "error: command with wrong type of arguments";
+            return;
+        }
+        vector <Polygon> grid = Pols[name].tiles(stod(x0), stod(y0), stod(w), stod(h), c, r);
+        for (int j = 0; j < r; ++j) {
+            for (int i = 0; i < c; ++i) {
+                if (grid[j*c + i].vertices() > 0) {
+                    Pols[prefix + '_' + to_string(i) + '_' + to_string(j)] = grid[j*c + i];
+                }
+            }
+        }
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Reads the side of an approximation (inner or outer). */
+bool read_side(const string& s, Polygon::Approximation& side, ostream& out) {
+    if (s == "inner") side = Polygon::inner;
+    else if (s == "outer") side = Polygon::outer;
+    else {
+        out << "error: command with wrong type of arguments";
+        return false;
+    }
+    return true;
+}
+
+
+/* Stores a convex approximation of a given polygon within a tolerance. */
+void Polygon_simplify(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2, tol, s;
+    if (iss >> p1 >> p2 >> tol >> s) {
+        if (undef_id(Pols, p2, out)) return;
+        if (wrong_number(iss, out)) return;
+        Polygon::Approximation side;
+        if (not read_side(s, side, out)) return;
+        Pols[p1] = Pols[p2].simplify(stod(tol), side);
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores a convex approximation of a given polygon with a maximum number of vertices. */
+void Polygon_decimate(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2, k, s;
+    if (iss >> p1 >> p2 >> k >> s) {
+        if (undef_id(Pols, p2, out)) return;
+        if (wrong_number(iss, out)) return;
+        Polygon::Approximation side;
+        if (not read_side(s, side, out)) return;
+        int m = stoi(k);
+        Polygon P = Pols[p2].simplifyVertices(m, side);
+        if (P.vertices() > max(m, 3)) {
+            out << "error: no approximation with so few vertices";
+            return;
+        }
+        Pols[p1] = P;
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores the levels of detail of a given polygon, one for each tolerance. */
+void Polygon_lod(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name, s, tol;
+    if (iss >> name >> s) {
+        if (undef_id(Pols, name, out)) return;
+        Polygon::Approximation side;
+        if (not read_side(s, side, out)) return;
+        vector <double> tolerances;
+        while (iss >> tol) tolerances.push_back(stod(tol));
+        Pols[name].setLevels(tolerances, side);
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Stores a level of detail of a given polygon (0 is the coarsest). */
+void Polygon_level(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string p1, p2, i;
+    if (iss >> p1 >> p2 >> i) {
+        if (undef_id(Pols, p2, out)) return;
+        if (wrong_number(iss, out)) return;
+        int l = stoi(i);
+        if (l < 0 or l >= Pols[p2].levels()) {
+            out << "error: command with wrong type of arguments";
+            return;
+        }
+        Pols[p1] = Pols[p2].level(l);
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Records the intersection or union of two given polygons as a pending
+   expression, to be evaluated when its value is needed (lazy mode). */
+void Polygon_lazy(map<string, Polygon>& Pols, map<string, shared_ptr<Expr>>& Pending,
+                  ExprTable& Table, Expr::Operation op, istringstream& iss, ostream& out) {
+    // Pending polygons are defined too.
+    auto undef = [&](const string& name) {
+        return not Pending.count(name) and undef_id(Pols, name, out);
+    };
+    string p1, p2, p3;
+    if (iss >> p1 >> p2) {
+        if (undef(p2)) return;
+        if (iss >> p3) {
+            if (undef(p3)) return;
+            if (wrong_number(iss, out)) return;
+        } else {
+            if (undef(p1)) return;
+            p3 = p2;
+            p2 = p1;
+        }
+        shared_ptr<Expr> e2 = Pending.count(p2) ? Pending[p2] : Table.value(Pols[p2]);
+        shared_ptr<Expr> e3 = Pending.count(p3) ? Pending[p3] : Table.value(Pols[p3]);
+        // The polygons stay unchanged (p1 is not even created) until p1 is
+        // evaluated, so other sessions never see an unfinished result.
+        Pending[p1] = Table.operation(op, e2, e3);
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Evaluates the pending expressions of the polygons used by a command line:
+   the ones named in it, or all of them for commands that use polygons not
+   named in the line (tiles writes prefix_i_j, * reads every polygon, and
+   list shows all the identifiers). */
+void force(map<string, Polygon>& Pols, map<string, shared_ptr<Expr>>& Pending, const string& s) {
+    istringstream iss(s);
+    string action, name;
+    vector <string> args;
+    iss >> action;
+    while (iss >> name) args.push_back(name);
+    bool all = action == "tiles" or action == "list" or find(args.begin(), args.end(), "*") != args.end();
+    if (all) {
+        args.clear();
+        for (const auto& e : Pending) args.push_back(e.first);
+    }
+    vector <string> names;
+    vector <shared_ptr<Expr>> exprs;
+    for (const string& name : args) {
+        if (Pending.count(name)) {
+            names.push_back(name);
+            exprs.push_back(Pending[name]);
+            Pending.erase(name);
+        }
+    }
+    Expr::evaluate(exprs);
+    for (int i = 0; i < (int)names.size(); ++i) Pols[names[i]] = exprs[i]->evaluate();
+}
+
+
+/* Switches the lazy mode on or off. In lazy mode, intersection and union
+   commands are only evaluated when their result is needed. */
+void Polygon_lazymode(map<string, Polygon>& Pols, map<string, shared_ptr<Expr>>& Pending,
+                      bool& lazy, istringstream& iss, ostream& out) {
+    string mode;
+    if (iss >> mode) {
+        if (wrong_number(iss, out)) return;
+        if (mode == "on") lazy = true;
+        else if (mode == "off") {
+            lazy = false;
+            string all = "lazy";
+            for (const auto& e : Pending) all += ' ' + e.first;
+            force(Pols, Pending, all);
+        } else {
+            out << "error: command with wrong type of arguments";
+            return;
+        }
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Switches the asynchronous draw mode on or off. */
+void Polygon_asyncmode(bool& async, istringstream& iss, ostream& out) {
+    string mode;
+    if (iss >> mode) {
+        if (wrong_number(iss, out)) return;
+        if (mode == "on") async = true;
+        else if (mode == "off") async = false;
+        else {
+            out << "error: command with wrong type of arguments";
+            return;
+        }
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Waits for the background draws of a client and prints, for each one, its
+   image and the milliseconds spent in the queue and rendering. */
+void Polygon_wait(Renderer& renderer, int client, istringstream& iss, ostream& out) {
+    if (wrong_number(iss, out)) return;
+    vector <Renderer::Job> jobs = renderer.wait(client);
+    if (jobs.empty()) out << "ok";
+    for (int i = 0; i < (int)jobs.size(); ++i) {
+        if (i > 0) out << "; ";
+        out << jobs[i].image << ' ' << jobs[i].queued << ' ' << jobs[i].rendering;
+    }
+}
+
+
+/* Prints the statistics of the commands and the Polygon operations, or the
+   latency histogram of one of them, or switches them on (optionally with
+   spans) or off, resets them, or saves the spans in the Chrome trace format. */
+void Polygon_stats(istringstream& iss, ostream& out) {
+    string mode, file;
+    if (not (iss >> mode)) {
+        Stats::print(out);
+        return;
+    }
+    if (mode == "save" or mode == "hist") {
+        if (not (iss >> file)) {
+            out << "error: command with wrong number of arguments";
+            return;
+        }
+    }
+    if (wrong_number(iss, out)) return;
+    if (mode == "hist") {
+        // Here "file" is the name of the operation.
+        if (not Stats::histogram(file, out)) out << "error: no calls of this operation";
+        return;
+    }
+    if (mode == "on") Stats::enable();
+    else if (mode == "trace") Stats::enable(true);
+    else if (mode == "off") Stats::disable();
+    else if (mode == "reset") Stats::reset();
+    else if (mode == "save") {
+        if (not Stats::save(file)) {
+            out << "error: the file cannot be written";
+            return;
+        }
+    } else {
+        out << "error: command with wrong type of arguments";
+        return;
+    }
+    out << "ok";
+}
+
+
+/* Prints yes or not to tell whether the first polygon is inside the second. */
+void Polygon_inside(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string name1, name2;
+    if (iss >> name1 >> name2) {
+        if (undef_id(Pols, name1, out)) return;
+        if (undef_id(Pols, name2, out)) return;
+        if (wrong_number(iss, out)) return;
+        if (Pols[name1].inside(Pols[name2])) out << "yes";
+        else out << "not";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Writes to a file the pairs of polygons of two lists (separated by "--")
+   that overlap, with the area of their intersection. */
+void Polygon_join(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string file;
+    if (iss >> file) {
+        vector <pair <string, Polygon>> A, B;
+        bool second = false;
+        string name;
+        while (iss >> name) {
+            if (name == "--" and not second) second = true;
+            else {
+                if (undef_id(Pols, name, out)) return;
+                (second ? B : A).push_back({name, Pols[name]});
+            }
+        }
+        if (not second) {
+            out << "error: command with wrong number of arguments";
+            return;
+        }
+        ofstream f(file);
+        join(A, B, f);
+        f.close();
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Computes the bounding box of the given polygons. */
+void Polygon_bbox(map<string, Polygon>& Pols, istringstream& iss, ostream& out) {
+    string bpol;
+    if (iss >> bpol) {
+        vp p;
+        //Color c = {0,0,0};
+        Pols[bpol] = Polygon(p);
+        string name;
+        while (iss >> name) Pols[bpol] = Pols[bpol].union_(Pols[name]);
+        Pols[bpol] = Pols[bpol].bbox();
+        out << "ok";
+    } else out << "error: command with wrong number of arguments";
+}
+
+
+/* Identifiers read and written by a command line. */
+struct Access {
+    // Whether the command needs the whole calculator.
+    bool exclusive = false;
+    // Whether the command reads every polygon.
+    bool all = false;
+    vector <string> reads, writes;
+};
+
+
+/* Returns the identifiers used by a command line. Commands that add or
+   remove identifiers (or unknown ones) need the whole calculator. */
+Access access(const string& line) {
+    istringstream iss(line);
+    string action, name;
+    iss >> action;
+    vector <string> args;
+    while (iss >> name) args.push_back(name);
+    int n = args.size();
+    Access a;
+    if (action == "print" or action == "area" or action == "perimeter" or
+        action == "vertices" or action == "centroid" or action == "edges" or
+        action == "regular" or action == "getcol" or action == "width" or
+        action == "height") {
+        if (n > 0 and args[0] == "*") a.all = true;
+        else if (n > 0) a.reads.push_back(args[0]);
+    } else if (action == "inside") {
+        for (int i = 0; i < n and i < 2; ++i) a.reads.push_back(args[i]);
+    } else if (action == "save" or action == "draw" or action == "join") {
+        for (int i = 1; i < n; ++i) if (args[i] != "--") a.reads.push_back(args[i]);
+    } else if (action == "polygon" or action == "halfplanes" or action == "setcol" or
+               action == "lod" or action == "hullfile") {
+        if (n > 0) a.writes.push_back(args[0]);
+    } else if (action == "intersection" or action == "union" or action == "minkowski" or
+               action == "minkowskidiff" or action == "bbox") {
+        if (n > 0) a.writes.push_back(args[0]);
+        for (int i = 1; i < n; ++i) a.reads.push_back(args[i]);
+    } else if (action == "clip" or action == "cut" or action == "simplify" or
+               action == "decimate" or action == "level") {
+        if (n > 0) a.writes.push_back(args[0]);
+        if (n > 1) a.reads.push_back(args[1]);
+    } else if (action != "list" and action != "wait" and action != "stats" and action != "#") {
+        a.exclusive = true;
+    }
+    return a;
+}
+
+
+/* Returns the vertices of the polygons used by a command line, for its
+   statistics. Only the polygons locked by the command are read. */
+long long used_vertices(map<string, Polygon>& Pols, const Access& a, const string& line) {
+    vector <string> names;
+    if (a.exclusive) {
+        istringstream iss(line);
+        string name;
+        iss >> name;
+        while (iss >> name) names.push_back(name);
+    } else if (a.all) {
+        for (const auto& e : Pols) names.push_back(e.first);
+    } else {
+        names = a.reads;
+        names.insert(names.end(), a.writes.begin(), a.writes.end());
+    }
+    long long vertices = 0;
+    for (const string& name : names) {
+        auto it = Pols.find(name);
+        if (it != Pols.end()) vertices += it->second.vertices();
+    }
+    return vertices;
+}
+
+
+/* Runs a command line of a session on the calculator, without locking it
+   (the command uses the polygons of a). */
+void dispatch(Calculator& calc, Session& session, const Access& a, const string& line, ostream& out) {
+    istringstream iss(line);
+    string action;
+    iss >> action;
+    Span span(action.empty() ? "(empty)" : action.c_str());
+    bool record = session.lazy and (action == "intersection" or action == "union");
+    // The answer is only written when the command finishes, so a command
+    // that fails leaves just its error.
+    ostringstream answer;
+    answer.copyfmt(out);
+    try {
+        if (not record and not session.Pending.empty()) force(calc.Pols, session.Pending, line);
+             if (record and action == "intersection") Polygon_lazy(calc.Pols, session.Pending, session.Table, Expr::intersection, iss, answer);
+        else if (record and action == "union")  Polygon_lazy(calc.Pols, session.Pending, session.Table, Expr::union_, iss, answer);
+        else if (action == "lazy")              Polygon_lazymode(calc.Pols, session.Pending, session.lazy, iss, answer);
+        else if (action == "async")             Polygon_asyncmode(session.async, iss, answer);
+        else if (action == "wait")              Polygon_wait(calc.renderer, session.id, iss, answer);
+        else if (action == "stats")             Polygon_stats(iss, answer);
+        else if (action == "polygon")           Polygon_def(calc.Pols, iss, answer);
+        else if (action == "halfplanes")        Polygon_halfplanes(calc.Pols, iss, answer);
+        else if (action == "print")             Polygon_print(calc.Pols, iss, answer);
+        else if (action == "area")              Polygon_area(calc, iss, answer);
+        else if (action == "perimeter")         Polygon_perimeter(calc, iss, answer);
+        else if (action == "vertices")          Polygon_vertices(calc.Pols, iss, answer);
+        else if (action == "centroid")          Polygon_centroid(calc, iss, answer);
+        else if (action == "edges")             Polygon_edges(calc.Pols, iss, answer);
+        else if (action == "regular")           Polygon_regular(calc.Pols, iss, answer);
+        else if (action == "getcol")            Polygon_getcol(calc.Pols, iss, answer);
+        else if (action == "width")             Polygon_width(calc.Pols, iss, answer);
+        else if (action == "height")             Polygon_height(calc.Pols, iss, answer);
+        else if (action == "list")              Polygon_list(calc.Pols, iss, answer);
+        else if (action == "save")              Polygon_save(calc.Pols, iss, answer);
+        else if (action == "load")              Polygon_load(calc.Pols, iss, answer);
+        else if (action == "hullfile")          Polygon_hullfile(calc.Pols, iss, answer);
+        else if (action == "setcol")            Polygon_setcol(calc.Pols, iss, answer);
+        else if (action == "draw")              Polygon_draw(calc.Pols, session.async ? &calc.renderer : nullptr, session.id, iss, answer);
+        else if (action == "intersection")      Polygon_intersection(calc.Pols, iss, answer);
+        else if (action == "union")             Polygon_union(calc.Pols, iss, answer);
+        else if (action == "minkowski")         Polygon_minkowski(calc.Pols, iss, answer);
+        else if (action == "minkowskidiff")     Polygon_minkowskidiff(calc.Pols, iss, answer);
+        else if (action == "clip")              Polygon_clip(calc.Pols, iss, answer);
+        else if (action == "cut")               Polygon_cut(calc.Pols, iss, answer);
+        else if (action == "tiles")             Polygon_tiles(calc.Pols, iss, answer);
+        else if (action == "simplify")          Polygon_simplify(calc.Pols, iss, answer);
+        else if (action == "decimate")          Polygon_decimate(calc.Pols, iss, answer);
+        else if (action == "lod")               Polygon_lod(calc.Pols, iss, answer);
+        else if (action == "level")             Polygon_level(calc.Pols, iss, answer);
+        else if (action == "inside")            Polygon_inside(calc.Pols, iss, answer);
+        else if (action == "bbox")              Polygon_bbox(calc.Pols, iss, answer);
+        else if (action == "join")              Polygon_join(calc.Pols, iss, answer);
+        else if (action == "#") answer << "#";
+        else answer << "error: invalid command";
+    } catch (const invalid_argument&) {
+        answer.str("");
+        answer << "error: command with wrong type of arguments";
+    } catch (const out_of_range&) {
+        answer.str("");
+        answer << "error: command with wrong type of arguments";
+    } catch (const bad_alloc&) {
+        answer.str("");
+        answer << "error: not enough memory";
+    } catch (const exception& e) {
+        answer.str("");
+        answer << "error: " << e.what();
+    }
+    out << answer.str();
+    if (Stats::enabled()) span.add(used_vertices(calc.Pols, a, line));
+}
+
+
+/* Executes a command line of a session on the calculator and writes its
+   answer (without the final end of line) to out. It can be called from
+   several threads at the same time, with different sessions. */
+void execute(Calculator& calc, Session& session, const string& line, ostream& out) {
+    Access a = access(line);
+    shared_lock <shared_timed_mutex> shared(calc.registry);
+    // Pending expressions and new identifiers change the map of polygons.
+    bool exclusive = a.exclusive or session.lazy or not session.Pending.empty();
+    for (const string& name : a.reads) if (not calc.Pols.count(name)) exclusive = true;
+    for (const string& name : a.writes) if (not calc.Pols.count(name)) exclusive = true;
+    if (exclusive) {
+        shared.unlock();
+        unique_lock <shared_timed_mutex> whole(calc.registry);
+        // Commands that only read polygons keep them unchanged, unless they
+        // evaluate pending expressions.
+        bool changes = a.exclusive or not a.writes.empty() or not session.Pending.empty();
+        dispatch(calc, session, a, line, out);
+        if (changes) ++calc.version;
+        return;
+    }
+    // Locks the stripes in increasing order, to avoid deadlocks.
+    vector <int> mode(Calculator::stripes, a.all ? 1 : 0);
+    hash <string> h;
+    for (const string& name : a.reads) mode[h(name)%Calculator::stripes] |= 1;
+    for (const string& name : a.writes) mode[h(name)%Calculator::stripes] |= 2;
+    // They are released when the guards are destroyed.
+    vector <unique_lock <shared_timed_mutex>> written;
+    vector <shared_lock <shared_timed_mutex>> read;
+    written.reserve(Calculator::stripes);
+    read.reserve(Calculator::stripes);
+    for (int i = 0; i < Calculator::stripes; ++i) {
+        if (mode[i] & 2) written.emplace_back(calc.polygons[i]);
+        else if (mode[i]) read.emplace_back(calc.polygons[i]);
+    }
+    dispatch(calc, session, a, line, out);
+    if (not a.writes.empty()) ++calc.version;
+}
+
+
+/* Ends a session: evaluates its pending expressions, so that their results
+   stay in the calculator, and waits for its background draws. */
+void finish(Calculator& calc, Session& session) {
+    calc.renderer.wait(session.id);
+    if (session.Pending.empty()) return;
+    unique_lock <shared_timed_mutex> whole(calc.registry);
+    string all = "lazy";
+    for (const auto& e : session.Pending) all += ' ' + e.first;
+    force(calc.Pols, session.Pending, all);
+    ++calc.version;
+}
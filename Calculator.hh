@@ -0,0 +1,115 @@
+#ifndef Calculator_hh
+#define Calculator_hh
+
+
+#include "Polygon.hh"
+#include "Expr.hh"
+#include "Renderer.hh"
+#include "PolygonSet.hh"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+using namespace std;
+
+
+/* All the polygons of a calculator as a PolygonSet (cfc. class PolygonSet),
+ * with their names in the same order, as they were at a given version.
+*/
+
+struct Snapshot {
+
+    /* Version of the polygons. */
+    long long version;
+
+    /* Names of the polygons. */
+    vector <string> names;
+
+    /* Polygons. */
+    PolygonSet set;
+
+};
+
+
+/* State of the convex polygon calculator: the named polygons (cfc. class
+ * Polygon), shared by all its sessions (cfc. struct Session). Several
+ * sessions can use a calculator at the same time: commands that only read
+ * some polygons run in parallel, and commands that write a polygon are
+ * serialized with the commands that use that same polygon.
+*/
+
+struct Calculator {
+
+    /* Named polygons. */
+    map <string, Polygon> Pols;
+
+    /* Background renderer of the draw commands. */
+    Renderer renderer;
+
+    /* Number of commands that may have changed the polygons. */
+    atomic <long long> version{0};
+
+    /* Last snapshot of the polygons, reused by the bulk commands while the
+       version does not change, and its lock. */
+    shared_ptr <const Snapshot> snapshot;
+    mutex snapshot_lock;
+
+    /* Lock of the whole calculator: shared by the commands that neither add
+       nor remove identifiers, exclusive for the rest. */
+    shared_timed_mutex registry;
+
+    /* Locks of the polygons, which are spread over a fixed number of stripes
+       by the hash of their identifiers. */
+    static const int stripes = 64;
+    shared_timed_mutex polygons[stripes];
+
+};
+
+
+/* State of a session of a calculator (cfc. struct Calculator): its modes
+ * and the pending expressions of its lazy mode (cfc. class Expr). Each
+ * client of the server has its own session, so the modes of a client do
+ * not change the commands of the others.
+*/
+
+struct Session {
+
+    /* Whether intersections and unions are recorded instead of evaluated. */
+    bool lazy = false;
+
+    /* Pending expressions of the lazy mode. */
+    map <string, shared_ptr <Expr>> Pending;
+
+    /* Shared subexpressions of the lazy mode. */
+    ExprTable Table;
+
+    /* Whether draw commands are rendered in the background. */
+    bool async = false;
+
+    /* Identifier of the session, whose background draws are waited for
+       (cfc. class Renderer) apart from the ones of other sessions. */
+    int id = ++count;
+
+    /* Number of sessions created. */
+    static atomic <int> count;
+
+};
+
+
+/* Executes a command line of a session on the calculator and writes its
+   answer (without the final end of line) to out. It can be called from
+   several threads at the same time, with different sessions. */
+void execute(Calculator& calc, Session& session, const string& line, ostream& out);
+
+
+/* Ends a session: evaluates its pending expressions, so that their results
+   stay in the calculator, and waits for its background draws. */
+void finish(Calculator& calc, Session& session);
+
+
+#endif
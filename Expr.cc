@@ -0,0 +1,126 @@
+#include "Expr.hh"
+#include "Polygon.hh"
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <thread>
+using namespace std;
+
+
+/* Number of threads evaluating expressions besides the calling ones. */
+atomic <int> Expr::workers(0);
+
+
+/* Constructor:
+Creates a node with the polygon P as its value. */
+Expr::Expr(const Polygon& P)
+:     op(value), result(P), done(true) {}
+
+
+/* Constructor:
+Creates a node for the operation op applied to left and right. */
+Expr::Expr(Operation op, const shared_ptr <Expr>& left, const shared_ptr <Expr>& right)
+:     op(op), left(left), right(right), done(false) {}
+
+
+/* Tries to reserve a thread for evaluating an expression. */
+bool Expr::reserve_worker() {
+    int limit = int(thread::hardware_concurrency()) - 1;
+    int n = workers.load();
+    while (n < limit) {
+        if (workers.compare_exchange_weak(n, n + 1)) return true;
+    }
+    return false;
+}
+
+
+/* Returns the polygon of this expression, evaluating it if needed.
+It can be called from several threads at the same time. */
+const Polygon& Expr::evaluate() {
+    if (done) return result;
+    call_once(once, [this] {
+        // If both operands are pending, the left one is evaluated in another thread.
+        future <void> job;
+        if (not left->done and not right->done and reserve_worker()) {
+            shared_ptr <Expr> l = left;
+            job = async(launch::async, [l] {
+                l->evaluate();
+                --workers;
+            });
+        }
+        const Polygon& b = right->evaluate();
+        if (job.valid()) job.get();
+        const Polygon& a = left->evaluate();
+        if (op == intersection) result = a.intersection(b);
+        else result = a.union_(b);
+        done = true;
+    });
+    return result;
+}
+
+
+/* Evaluates all the given expressions, in parallel if possible. */
+void Expr::evaluate(const vector <shared_ptr <Expr>>& exprs) {
+    vector <future <void>> jobs;
+    int n = exprs.size();
+    for (int i = 0; i + 1 < n; ++i) {
+        if (not exprs[i]->done and reserve_worker()) {
+            shared_ptr <Expr> e = exprs[i];
+            jobs.push_back(async(launch::async, [e] {
+                e->evaluate();
+                --workers;
+            }));
+        }
+    }
+    for (int i = 0; i < n; ++i) exprs[i]->evaluate();
+    for (auto& job : jobs) job.get();
+}
+
+
+/* Returns a node with the polygon P as its value. */
+shared_ptr <Expr> ExprTable::value(const Polygon& P) {
+    weak_ptr <Expr>& entry = values[&P.getPoints()];
+    shared_ptr <Expr> e = entry.lock();
+    if (not e) {
+        e = make_shared<Expr>(P);
+        entry = e;
+        prune();
+    }
+    return e;
+}
+
+
+/* Returns a node for the operation op applied to left and right. */
+shared_ptr <Expr> ExprTable::operation(Expr::Operation op, const shared_ptr <Expr>& left, const shared_ptr <Expr>& right) {
+    // While a node is alive, so are its operands, and their addresses
+    // cannot be reused by other nodes.
+    weak_ptr <Expr>& entry = operations[make_tuple(int(op), left.get(), right.get())];
+    shared_ptr <Expr> e = entry.lock();
+    if (not e) {
+        e = make_shared<Expr>(op, left, right);
+        entry = e;
+        prune();
+    }
+    return e;
+}
+
+
+/* Removes the entries of the nodes that are no longer alive,
+when the tables have doubled their size since the last time. */
+void ExprTable::prune() {
+    if (values.size() + operations.size() < 2*pruned + 64) return;
+    for (auto it = values.begin(); it != values.end(); ) {
+        if (it->second.expired()) it = values.erase(it);
+        else ++it;
+    }
+    for (auto it = operations.begin(); it != operations.end(); ) {
+        if (it->second.expired()) it = operations.erase(it);
+        else ++it;
+    }
+    pruned = values.size() + operations.size();
+}
@@ -0,0 +1,105 @@
+#ifndef Expr_hh
+#define Expr_hh
+
+
+#include "Polygon.hh"
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <atomic>
+using namespace std;
+
+
+/* The Expr class stores a node of a lazy expression over polygons
+ * (cfc. class Polygon): either a polygon value or the intersection or
+ * union of two expressions. The value of a node is computed only once,
+ * when it is first needed, and independent branches are evaluated in
+ * parallel.
+*/
+
+class Expr {
+
+    public:
+
+    /* Operation of a node. */
+    enum Operation { value, intersection, union_ };
+
+    /* Constructor:
+       Creates a node with the polygon P as its value. */
+    Expr(const Polygon& P);
+
+    /* Constructor:
+       Creates a node for the operation op applied to left and right. */
+    Expr(Operation op, const shared_ptr <Expr>& left, const shared_ptr <Expr>& right);
+
+    /* Returns the polygon of this expression, evaluating it if needed.
+       It can be called from several threads at the same time. */
+    const Polygon& evaluate();
+
+    /* Evaluates all the given expressions, in parallel if possible. */
+    static void evaluate(const vector <shared_ptr <Expr>>& exprs);
+
+    private:
+
+    /* Operation of the node. */
+    Operation op;
+
+    /* Operands of the node (null for values). */
+    shared_ptr <Expr> left, right;
+
+    /* Polygon of the node, once evaluated. */
+    Polygon result;
+
+    /* Makes sure that the node is evaluated only once. */
+    once_flag once;
+
+    /* Tells whether the node has already been evaluated. */
+    atomic <bool> done;
+
+    /* Number of threads evaluating expressions besides the calling ones. */
+    static atomic <int> workers;
+
+    /* Tries to reserve a thread for evaluating an expression. */
+    static bool reserve_worker();
+
+};
+
+
+/* The ExprTable class creates expression nodes (cfc. class Expr),
+ * returning the existing node when an identical one is still alive,
+ * so that identical subexpressions are evaluated only once.
+*/
+
+class ExprTable {
+
+    public:
+
+    /* Returns a node with the polygon P as its value. */
+    shared_ptr <Expr> value(const Polygon& P);
+
+    /* Returns a node for the operation op applied to left and right. */
+    shared_ptr <Expr> operation(Expr::Operation op, const shared_ptr <Expr>& left, const shared_ptr <Expr>& right);
+
+    private:
+
+    /* Value nodes, by the address of the vector of points of their polygon
+       (the vector is shared by all the copies of a polygon). */
+    map <const void*, weak_ptr <Expr>> values;
+
+    /* Operation nodes, by their operation and operands. */
+    map <tuple <int, Expr*, Expr*>, weak_ptr <Expr>> operations;
+
+    /* Removes the entries of the nodes that are no longer alive,
+       when the tables have doubled their size since the last time. */
+    void prune();
+
+    /* Size of the tables after the last pruning. */
+    size_t pruned = 0;
+
+};
+
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HalfPlane_hh
+#define HalfPlane_hh
+
+
+/* The HalfPlane struct stores the half-plane of the points (x, y)
+ * such that a*x + b*y <= c.
+ */
+
+struct HalfPlane {
+    double a;
+    double b;
+    double c;
+};
+
+
+#endif
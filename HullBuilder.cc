@@ -0,0 +1,116 @@
+#include "HullBuilder.hh"
+#include "Point.hh"
+#include "Polygon.hh"
+
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+using namespace std;
+
+using vp = vector <Point>;
+
+
+/* Constructor:
+Creates an empty builder that reduces its points to their convex hull
+every "chunk" points.
+If "epsilon" is positive, only the extreme points in k = pi/atan(2*epsilon)
+fixed directions are kept between chunks, so memory is O(chunk + 1/epsilon),
+and the Hausdorff distance from the result to the exact convex hull is
+at most epsilon times the diameter of the points. */
+HullBuilder::HullBuilder(int chunk, double epsilon)
+:     chunk(chunk > 0 ? chunk : 1), hull_size(0), n(0) {
+    if (epsilon > 0) {
+        // Between two consecutive directions, the hull may bulge at most
+        // diameter*tan(pi/k)/2 beyond the chord of their extreme points.
+        int k = max(4, int(ceil(M_PI/atan(2*epsilon))));
+        for (int i = 0; i < k; ++i) {
+            directions.push_back(Point(cos(2*M_PI*i/k), sin(2*M_PI*i/k)));
+        }
+    }
+}
+
+
+/* Adds point P to the stream. */
+void HullBuilder::add(const Point& P) {
+    points.push_back(P);
+    ++n;
+    if (int(points.size()) >= hull_size + chunk) reduce();
+}
+
+
+/* Adds the points read from the file descriptor fd until its end, given as
+pairs of coordinates separated by whitespace. Returns false if the file
+cannot be read or has a wrong number. */
+bool HullBuilder::add(int fd) {
+    const int size = 1 << 16;
+    vector <char> buf(size + 1);
+    string token;     // Number split between two reads.
+    double coord[2];
+    int k = 0;        // Number of coordinates of the current point.
+    while (true) {
+        ssize_t len = read(fd, buf.data(), size);
+        if (len < 0) return false;
+        bool eof = (len == 0);
+        // A final separator ends the last number.
+        if (eof) buf[len++] = ' ';
+        int i = 0;
+        while (i < len) {
+            int j = i;
+            while (j < len and not isspace((unsigned char)buf[j])) ++j;
+            token.append(buf.data() + i, j - i);
+            if (j == len) break;    // The number may go on in the next read.
+            if (not token.empty()) {
+                char* end;
+                coord[k++] = strtod(token.c_str(), &end);
+                if (*end != '\0') return false;
+                if (k == 2) {
+                    add(Point(coord[0], coord[1]));
+                    k = 0;
+                }
+                token.clear();
+            }
+            i = j + 1;
+        }
+        if (eof) return k == 0;
+    }
+}
+
+
+/* Returns the number of points added so far. */
+long long HullBuilder::count() const {
+    return n;
+}
+
+
+/* Returns the convex hull of the points added so far. */
+Polygon HullBuilder::hull() const {
+    return Polygon(points);
+}
+
+
+/* Reduces the points to their convex hull (or to its extreme points
+in the approximate mode). */
+void HullBuilder::reduce() {
+    points = Polygon(points).getPoints();
+    if (not directions.empty() and points.size() > directions.size()) {
+        // Keeps the extreme vertices in each direction, in hull order.
+        int h = points.size();
+        vector <bool> extreme(h, false);
+        for (const Point& u : directions) {
+            int best = 0;
+            for (int i = 1; i < h; ++i) {
+                if (points[i].getX()*u.getX() + points[i].getY()*u.getY() >
+                    points[best].getX()*u.getX() + points[best].getY()*u.getY()) best = i;
+            }
+            extreme[best] = true;
+        }
+        vp kept;
+        for (int i = 0; i < h; ++i) if (extreme[i]) kept.push_back(points[i]);
+        points = kept;
+    }
+    hull_size = points.size();
+}
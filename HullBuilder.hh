@@ -0,0 +1,75 @@
+#ifndef HullBuilder_hh
+#define HullBuilder_hh
+
+
+#include "Point.hh"
+#include "Polygon.hh"
+
+#include <vector>
+using namespace std;
+
+
+/* The HullBuilder class computes the convex hull of a stream of points
+ * (cfc. class Point) with bounded memory: the points are added chunk by
+ * chunk, and only the convex hull of the points seen so far is kept
+ * between chunks.
+*/
+
+class HullBuilder {
+
+    public:
+
+    /* Constructor:
+       Creates an empty builder that reduces its points to their convex hull
+       every "chunk" points.
+       If "epsilon" is positive, only the extreme points in k = pi/atan(2*epsilon)
+       fixed directions are kept between chunks, so memory is O(chunk + 1/epsilon),
+       and the Hausdorff distance from the result to the exact convex hull is
+       at most epsilon times the diameter of the points. */
+    HullBuilder(int chunk = 1 << 16, double epsilon = 0);
+
+    /* Adds point P to the stream. */
+    void add(const Point& P);
+
+    /* Adds the points in [first, last) to the stream. */
+    template <class Iterator>
+    void add(Iterator first, Iterator last) {
+        for (; first != last; ++first) add(*first);
+    }
+
+    /* Adds the points read from the file descriptor fd until its end, given as
+       pairs of coordinates separated by whitespace. Returns false if the file
+       cannot be read or has a wrong number. */
+    bool add(int fd);
+
+    /* Returns the number of points added so far. */
+    long long count() const;
+
+    /* Returns the convex hull of the points added so far. */
+    Polygon hull() const;
+
+    private:
+
+    /* Number of points added between reductions. */
+    int chunk;
+
+    /* Directions of the approximate mode (empty in the exact mode). */
+    vector <Point> directions;
+
+    /* Vertices of the current hull, followed by the points added since. */
+    vector <Point> points;
+
+    /* Number of vertices of the current hull at the beginning of "points". */
+    int hull_size;
+
+    /* Number of points added so far. */
+    long long n;
+
+    /* Reduces the points to their convex hull (or to its extreme points
+       in the approximate mode). */
+    void reduce();
+
+};
+
+
+#endif
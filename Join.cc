@@ -0,0 +1,197 @@
+#include "Join.hh"
+#include "Polygon.hh"
+#include "Point.hh"
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <limits>
+using namespace std;
+
+using vp = vector <Point>;
+
+
+/* A polygon prepared for the join: its bounding box and its upper and
+   lower chains, both sorted by X. */
+struct Shape {
+    const string* id;
+    double xmin, xmax, ymin, ymax;
+    vp upper, lower;
+};
+
+
+/* Prepares the convex polygon v (as given by getPoints()) for the join.
+   Returns false if it has no area. */
+static bool prepare(const string& id, const vp& v, Shape& S) {
+    int n = v.size();
+    if (n < 3) return false;
+    S.id = &id;
+    // The points start at the leftmost and downmost one, in clockwise order,
+    // so the upper chain goes from there to the rightmost and upmost one.
+    int last = 0;
+    S.ymin = S.ymax = v[0].getY();
+    for (int i = 1; i < n; ++i) {
+        if (v[i].getX() > v[last].getX() or
+            (v[i].getX() == v[last].getX() and v[i].getY() > v[last].getY())) last = i;
+        S.ymin = min(S.ymin, v[i].getY());
+        S.ymax = max(S.ymax, v[i].getY());
+    }
+    S.xmin = v[0].getX();
+    S.xmax = v[last].getX();
+    if (S.xmin == S.xmax or S.ymin == S.ymax) return false;
+    S.upper.assign(v.begin(), v.begin() + last + 1);
+    S.lower.assign(v.begin() + last, v.end());
+    S.lower.push_back(v[0]);
+    reverse(S.lower.begin(), S.lower.end());
+    return true;
+}
+
+
+/* A cursor over a chain that gives, for consecutive intervals [x0, x1]
+   between breakpoints, the segment of the chain over them. */
+struct Cursor {
+    const vp& chain;
+    int i;
+    Cursor(const vp& c) : chain(c), i(0) {}
+    // Moves to the segment over the interval starting at x0.
+    void seek(double x0) {
+        while (i + 2 < int(chain.size()) and chain[i+1].getX() <= x0) ++i;
+    }
+    // Value of the current segment at x.
+    double at(double x) const {
+        const Point& a = chain[i];
+        const Point& b = chain[i+1];
+        if (b.getX() == a.getX()) return a.getY();
+        return a.getY() + (x - a.getX())*(b.getY() - a.getY())/(b.getX() - a.getX());
+    }
+    // X of the next vertex after x0, or infinity.
+    double next(double x0) const {
+        for (int j = i + 1; j < int(chain.size()); ++j) {
+            if (chain[j].getX() > x0) return chain[j].getX();
+        }
+        return HUGE_VAL;
+    }
+};
+
+
+/* Returns the integral over [x0, x1] of max(0, h), for h linear with
+   h(x0) = h0 and h(x1) = h1. */
+static double positive_part(double x0, double x1, double h0, double h1) {
+    if (h0 >= 0 and h1 >= 0) return (x1 - x0)*(h0 + h1)/2;
+    if (h0 <= 0 and h1 <= 0) return 0;
+    // The sign changes inside the interval.
+    double h = max(h0, h1);
+    return (x1 - x0)*h/(abs(h0) + abs(h1))*h/2;
+}
+
+
+/* Returns the area of the intersection of two prepared polygons, integrating
+   min(upper) - max(lower) between consecutive vertices of the four chains. */
+static double overlap_area(const Shape& a, const Shape& b) {
+    double L = max(a.xmin, b.xmin);
+    double R = min(a.xmax, b.xmax);
+    if (L >= R) return 0;
+    Cursor ua(a.upper), la(a.lower), ub(b.upper), lb(b.lower);
+    double area = 0;
+    double x0 = L;
+    while (x0 < R) {
+        ua.seek(x0); la.seek(x0); ub.seek(x0); lb.seek(x0);
+        double x1 = min(min(R, min(ua.next(x0), la.next(x0))), min(ub.next(x0), lb.next(x0)));
+        // The minimum of the upper segments and the maximum of the lower
+        // ones are linear except where the segments cross.
+        vector <double> cuts = {x0, x1};
+        double du0 = ua.at(x0) - ub.at(x0), du1 = ua.at(x1) - ub.at(x1);
+        if ((du0 < 0 and du1 > 0) or (du0 > 0 and du1 < 0)) cuts.push_back(x0 + (x1 - x0)*du0/(du0 - du1));
+        double dl0 = la.at(x0) - lb.at(x0), dl1 = la.at(x1) - lb.at(x1);
+        if ((dl0 < 0 and dl1 > 0) or (dl0 > 0 and dl1 < 0)) cuts.push_back(x0 + (x1 - x0)*dl0/(dl0 - dl1));
+        sort(cuts.begin(), cuts.end());
+        for (int k = 0; k + 1 < int(cuts.size()); ++k) {
+            double s0 = cuts[k], s1 = cuts[k+1];
+            double mid = (s0 + s1)/2;
+            // Picks the segments that are the minimum and maximum on this piece.
+            const Cursor& u = (ua.at(mid) < ub.at(mid) ? ua : ub);
+            const Cursor& l = (la.at(mid) > lb.at(mid) ? la : lb);
+            area += positive_part(s0, s1, u.at(s0) - l.at(s0), u.at(s1) - l.at(s1));
+        }
+        x0 = x1;
+    }
+    return area;
+}
+
+
+/* Sweeps a chunk of A against B, both sorted by xmin, writing the rows of
+   the pairs that overlap to out. */
+static void sweep(const vector <Shape>& A, int first, int last, const vector <Shape>& B,
+                  ostream& out, mutex& lock) {
+    // The areas are written with all their digits, whatever the format of out.
+    ostringstream rows;
+    rows.precision(numeric_limits<double>::max_digits10);
+    vector <const Shape*> activeA, activeB;
+    int i = first, j = 0;
+    int nb = B.size();
+    auto test = [&](const Shape& a, const Shape& b) {
+        if (a.ymin >= b.ymax or b.ymin >= a.ymax) return;
+        double area = overlap_area(a, b);
+        if (area > 0) rows << *a.id << ' ' << *b.id << ' ' << area << '\n';
+    };
+    auto flush = [&]() {
+        lock_guard <mutex> guard(lock);
+        out << rows.str();
+        rows.str("");
+    };
+    while (i < last or (j < nb and not activeA.empty())) {
+        if (j == nb or (i < last and A[i].xmin <= B[j].xmin)) {
+            const Shape& a = A[i++];
+            // Removes the boxes of B that end before this one starts.
+            activeB.erase(remove_if(activeB.begin(), activeB.end(),
+                          [&](const Shape* b) { return b->xmax <= a.xmin; }), activeB.end());
+            for (const Shape* b : activeB) test(a, *b);
+            activeA.push_back(&a);
+        } else {
+            const Shape& b = B[j++];
+            activeA.erase(remove_if(activeA.begin(), activeA.end(),
+                          [&](const Shape* a) { return a->xmax <= b.xmin; }), activeA.end());
+            for (const Shape* a : activeA) test(*a, b);
+            activeB.push_back(&b);
+        }
+        if (rows.tellp() > (1 << 16)) flush();
+    }
+    flush();
+}
+
+
+/* Spatial join of two collections of named polygons (cfc. class Polygon).
+For each pair (a, b), with a in A and b in B, whose intersection has a
+positive area, writes a line "idA idB area" to out (in no particular order).
+The candidate pairs are found sweeping the bounding boxes along the X axis
+(sweep and prune), and the area of each candidate is computed in
+O(n + m) time from the upper and lower chains of both polygons, without
+creating any polygon. The polygons of A are split among "threads" threads
+(0 means as many as the hardware supports). */
+void join(const vector <pair <string, Polygon>>& A, const vector <pair <string, Polygon>>& B,
+          ostream& out, int threads) {
+    vector <Shape> SA, SB;
+    Shape S;
+    for (const auto& e : A) if (prepare(e.first, e.second.getPoints(), S)) SA.push_back(S);
+    for (const auto& e : B) if (prepare(e.first, e.second.getPoints(), S)) SB.push_back(S);
+    auto by_xmin = [](const Shape& s, const Shape& t) { return s.xmin < t.xmin; };
+    sort(SA.begin(), SA.end(), by_xmin);
+    sort(SB.begin(), SB.end(), by_xmin);
+    if (threads <= 0) threads = max(1, int(thread::hardware_concurrency()));
+    int n = SA.size();
+    threads = max(1, min(threads, n/64));
+    mutex lock;
+    vector <thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.push_back(thread(sweep, cref(SA), t*n/threads, (t+1)*n/threads,
+                                 cref(SB), ref(out), ref(lock)));
+    }
+    sweep(SA, 0, n/threads, SB, out, lock);
+    for (thread& w : workers) w.join();
+}
@@ -0,0 +1,26 @@
+#ifndef Join_hh
+#define Join_hh
+
+
+#include "Polygon.hh"
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+using namespace std;
+
+
+/* Spatial join of two collections of named polygons (cfc. class Polygon).
+ * For each pair (a, b), with a in A and b in B, whose intersection has a
+ * positive area, writes a line "idA idB area" to out (in no particular order).
+ * The candidate pairs are found sweeping the bounding boxes along the X axis
+ * (sweep and prune), and the area of each candidate is computed in
+ * O(n + m) time from the upper and lower chains of both polygons, without
+ * creating any polygon. The polygons of A are split among "threads" threads
+ * (0 means as many as the hardware supports). */
+void join(const vector <pair <string, Polygon>>& A, const vector <pair <string, Polygon>>& B,
+          ostream& out, int threads = 0);
+
+
+#endif
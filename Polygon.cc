@@ -1,11 +1,15 @@
 #include "Polygon.hh"
 #include "Point.hh"
 #include "Color.hh"
+#include "HalfPlane.hh"
+#include "Stats.hh"
 
 #include <iostream>
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <deque>
+#include <limits>
 using namespace std;
 
 using vp = vector <Point>;
@@ -17,11 +21,92 @@ The points vector is optional and defaults to an empty vector.
 The c color is optional and defaults to (R, G, B) = (0, 0, 0). 
 The vector of points is updated to its convex hull. */
 Polygon::Polygon(const vp& points, Color c) 
-:     points(points), c(c) {
+:     buffer(make_shared<vp>(points)), c(c) {
    convexHull();
 }
 
 
+/* A half-plane given as the points at the left of the line through p
+   with unit direction (dx, dy), used by the half-plane intersection. */
+struct Line {
+    Point p;
+    double dx, dy;
+    double angle;
+};
+
+
+/* Checks whether point P is strictly outside the half-plane of line L. */
+static bool out(const Line& L, const Point& P) {
+    return L.dx*(P.getY() - L.p.getY()) - L.dy*(P.getX() - L.p.getX()) < -1e-9;
+}
+
+
+/* Returns the intersection point of two non-parallel lines. */
+static Point meet(const Line& s, const Line& t) {
+    double ux = t.p.getX() - s.p.getX();
+    double uy = t.p.getY() - s.p.getY();
+    double alpha = (ux*t.dy - uy*t.dx)/(s.dx*t.dy - s.dy*t.dx);
+    double x = s.p.getX() + alpha*s.dx;
+    double y = s.p.getY() + alpha*s.dy;
+    if (abs(x) < 1e-12) x = 0;
+    if (abs(y) < 1e-12) y = 0;
+    return Point(x, y);
+}
+
+
+/* Constructor:
+Creates the polygon formed by the intersection of the half-planes "H",
+with color "c", in O(n log n) time. The vertices are already computed
+in convex order, so no convex hull is needed. Unbounded intersections
+are limited to the square |x|, |y| <= 1e9. */
+Polygon::Polygon(const vector <HalfPlane>& H, Color c)
+:     buffer(make_shared<vp>()), c(c) {
+    const double bound = 1e9;
+    vector <HalfPlane> planes = {{1, 0, bound}, {0, 1, bound}, {-1, 0, bound}, {0, -1, bound}};
+    planes.insert(planes.end(), H.begin(), H.end());
+    vector <Line> lines;
+    for (const HalfPlane& h : planes) {
+        double norm = sqrt(h.a*h.a + h.b*h.b);
+        if (norm < 1e-12) {
+            // 0 <= c holds everywhere or nowhere.
+            if (h.c < 0) return;
+            continue;
+        }
+        // The points at the left of direction (-b, a) satisfy a*x + b*y <= c.
+        Line L;
+        L.p = Point(h.a*h.c/(norm*norm), h.b*h.c/(norm*norm));
+        L.dx = -h.b/norm;
+        L.dy = h.a/norm;
+        L.angle = atan2(L.dy, L.dx);
+        lines.push_back(L);
+    }
+    sort(lines.begin(), lines.end(), [](const Line& s, const Line& t) {
+        return s.angle < t.angle;
+    });
+    // Sweeps the lines by angle, keeping the useful ones in a deque.
+    deque <Line> dq;
+    for (const Line& L : lines) {
+        while (dq.size() > 1 and out(L, meet(dq[dq.size()-1], dq[dq.size()-2]))) dq.pop_back();
+        while (dq.size() > 1 and out(L, meet(dq[0], dq[1]))) dq.pop_front();
+        if (not dq.empty() and abs(L.dx*dq.back().dy - L.dy*dq.back().dx) < 1e-12) {
+            // Opposite parallel half-planes that do not overlap.
+            if (L.dx*dq.back().dx + L.dy*dq.back().dy < 0) return;
+            // Parallel half-planes: keeps the inner one.
+            if (out(L, dq.back().p)) dq.pop_back();
+            else continue;
+        }
+        dq.push_back(L);
+    }
+    while (dq.size() > 2 and out(dq[0], meet(dq[dq.size()-1], dq[dq.size()-2]))) dq.pop_back();
+    while (dq.size() > 2 and out(dq[dq.size()-1], meet(dq[0], dq[1]))) dq.pop_front();
+    if (dq.size() < 3) return;
+    vp v;
+    int n = dq.size();
+    for (int i = 0; i < n; ++i) v.push_back(meet(dq[i], dq[(i+1)%n]));
+    buffer = from_hull(v).buffer;
+}
+
+
 /* Comparison for sorting "points". */
 struct Polygon::Comp {
     Point O;
@@ -59,8 +144,18 @@ static bool leftof(Point a, Point b, Point c) {
 }
 
 
+/* Gets the vector of points of this polygon for writing,
+   copying it first if it is shared with other polygons. */
+vp& Polygon::writable_points() {
+    if (buffer.use_count() > 1) buffer = make_shared<vp>(*buffer);
+    return *buffer;
+}
+
+
 /* Updates the vector of points to its convex hull. */
 void Polygon::convexHull() {
+    Span span("Polygon::convexHull", buffer->size());
+    vp& points = writable_points();
     int n = points.size();
     if (n < 2) return;
     if (n == 2) {
@@ -95,9 +190,61 @@ void Polygon::convexHull() {
 }
 
 
+/* Returns twice the signed area of the polygon v
+   (positive when v is in counterclockwise order). */
+static double signed_area2(const vp& v) {
+    double sum = 0;
+    int n = v.size();
+    for (int i = 0; i < n; ++i) {
+        int i1 = (i+1 != n ? i+1 : 0);
+        sum += v[i].getX()*v[i1].getY() - v[i1].getX()*v[i].getY();
+    }
+    return sum;
+}
+
+
+/* Rotates v so that it starts at its leftmost and downmost point. */
+static void rotate_leftmost(vp& v) {
+    int n = v.size();
+    int left = 0;
+    for (int i = 1; i < n; ++i) {
+        if (v[i].getX() < v[left].getX() or
+            (v[i].getX() == v[left].getX() and v[i].getY() < v[left].getY())) left = i;
+    }
+    rotate(v.begin(), v.begin() + left, v.end());
+}
+
+
+/* Creates a polygon from points that are already in convex order,
+   without computing their convex hull again. Repeated and aligned points
+   are removed, and the vertices are left clockwise starting at the
+   leftmost and downmost one, as convexHull() does. */
+Polygon Polygon::from_hull(const vp& hull, Color c) {
+    vp v;
+    for (const Point& P : hull) {
+        if (v.empty() or v.back().distance(P) >= 1e-12) v.push_back(P);
+    }
+    while (v.size() > 1 and v.back().distance(v[0]) < 1e-12) v.pop_back();
+    double a = signed_area2(v);
+    // Degenerate polygons (points and segments) are left to convexHull().
+    if (v.size() < 3 or abs(a) < 1e-12) return Polygon(v, c);
+    if (a > 0) reverse(v.begin(), v.end());
+    vp w;
+    int n = v.size();
+    for (int i = 0; i < n; ++i) {
+        if (not aligned(v[(i+n-1)%n], v[i], v[(i+1)%n])) w.push_back(v[i]);
+    }
+    rotate_leftmost(w);
+    Polygon P;
+    P.buffer = make_shared<vp>(w);
+    P.c = c;
+    return P;
+}
+
+
 /* Gets the vector of points of this polygon. */
-vp Polygon::getPoints() const {
-    return points;
+const vp& Polygon::getPoints() const {
+    return *buffer;
 }
 
 
@@ -109,8 +256,11 @@ Color Polygon::getcol() const {
 
 /* Returns the area of this polygon. */
 double Polygon::area() const {
+    Span span("Polygon::area", buffer->size());
+    const vp& points = *buffer;
     double sum = 0;
     int n = points.size();
+    if (n == 0) return 0;
     // We use shoelace formula.
     for (int i = 0; i < n-1; ++i) {
         sum += points[i].getX()*points[i+1].getY();
@@ -125,6 +275,8 @@ double Polygon::area() const {
 
 /* Returns the perimeter of this polygon. */
 double Polygon::perimeter() const {
+    Span span("Polygon::perimeter", buffer->size());
+    const vp& points = *buffer;
     double sum = 0;
     int n = points.size();
     for (int i = 0; i < n; ++i) sum += points[i].distance(points[(i+1)%n]);
@@ -134,12 +286,14 @@ double Polygon::perimeter() const {
 
 /* Returns the number of vertices of this polygon. */
 int Polygon::vertices() const {
-    return int(points.size());
+    return int(buffer->size());
 }
 
 
 /* Returns the centroid of this polygon. */
 Point Polygon::centroid() const {
+    Span span("Polygon::centroid", buffer->size());
+    const vp& points = *buffer;
     Point Centroid(0, 0);
     int n = points.size();
     for (int i = 0; i < n; ++i) Centroid += points[i];
@@ -151,7 +305,7 @@ Point Polygon::centroid() const {
 
 /* Returns the number of edges of this polygon. */
 int Polygon::edges() const {
-    int size = points.size();
+    int size = buffer->size();
     if (size == 1) return 0;
     if (size == 2) return 1;
     return size;
@@ -160,6 +314,7 @@ int Polygon::edges() const {
 
 /* Check whether this polygon is regular. */
 bool Polygon::regular() const {
+    const vp& points = *buffer;
     int n = points.size();
     if (n > 3){
         double d = points[n-1].distance(points[0]);
@@ -173,9 +328,8 @@ bool Polygon::regular() const {
 
 /* Returns the width of this polygon. */
 double Polygon::width() const {
-    Polygon Box = *this;
-    Box = Box.bbox();
-    vp pBox = Box.getPoints();
+    Polygon Box = bbox();
+    const vp& pBox = Box.getPoints();
     int n = pBox.size();
     if (n < 2) return 0;
     //Invariant: n == 4.
@@ -185,9 +339,8 @@ double Polygon::width() const {
 
 /* Returns the height of this polygon. */
 double Polygon::height() const {
-    Polygon Box = *this;
-    Box = Box.bbox();
-    vp pBox = Box.getPoints();
+    Polygon Box = bbox();
+    const vp& pBox = Box.getPoints();
     int n = pBox.size();
     if (n < 2) return 0;
     //Invariant: n == 4.
@@ -204,11 +357,12 @@ void Polygon::setcol(Color col) {
 /* Checks whether point P is inside the polygon V. */
 static bool in(const Point& P, const vp& v) {
     int n = v.size();
+    if (n == 0) return false;
     for (int i = 0; i + 1 < n; ++i) {
         //srictly leftof
         if (leftof(v[i], v[i+1], P) and not aligned(v[i], v[i+1], P)) return false;
     }
-    if (leftof(v[n-1], v[0], P)) return false;
+    if (leftof(v[n-1], v[0], P) and not aligned(v[n-1], v[0], P)) return false;
     return true;
 }
 
@@ -262,10 +416,66 @@ static void inter_seg(const vp& ppoints, const vp& vpoints, vp& inter) {
 }
 
 
+/* Splits the convex polygon v by the boundary of the half-plane h.
+   The points of v inside h are added to in and, if out is not null, the
+   points outside h are added to out, keeping the order of v. */
+static void split(const vp& v, const HalfPlane& h, vp& in, vp* out) {
+    int n = v.size();
+    for (int i = 0; i < n; ++i) {
+        const Point& P = v[i];
+        const Point& Q = v[i+1 != n ? i+1 : 0];
+        double sP = h.a*P.getX() + h.b*P.getY() - h.c;
+        double sQ = h.a*Q.getX() + h.b*Q.getY() - h.c;
+        if (abs(sP) < 1e-12) sP = 0;
+        if (abs(sQ) < 1e-12) sQ = 0;
+        if (sP <= 0) in.push_back(P);
+        if (sP >= 0 and out) out->push_back(P);
+        // The edge PQ crosses the boundary of h.
+        if ((sP < 0 and sQ > 0) or (sP > 0 and sQ < 0)) {
+            double t = sP/(sP - sQ);
+            Point X(P.getX() + t*(Q.getX() - P.getX()), P.getY() + t*(Q.getY() - P.getY()));
+            in.push_back(X);
+            if (out) out->push_back(X);
+        }
+    }
+}
+
+
+/* Returns the points of the convex polygon v inside the rectangle
+   [xmin, xmax] x [ymin, ymax], in order. */
+static vp clip_rect(const vp& v, double xmin, double ymin, double xmax, double ymax) {
+    HalfPlane sides[4] = {{-1, 0, -xmin}, {0, 1, ymax}, {1, 0, xmax}, {0, -1, -ymin}};
+    vp in = v;
+    for (int i = 0; i < 4; ++i) {
+        vp next;
+        split(in, sides[i], next, nullptr);
+        in.swap(next);
+    }
+    return in;
+}
+
+
+/* Checks whether v is an axis-aligned rectangle, as given by convexHull(). */
+static bool is_rect(const vp& v) {
+    return v.size() == 4 and v[0].getX() == v[1].getX() and v[1].getY() == v[2].getY()
+        and v[2].getX() == v[3].getX() and v[3].getY() == v[0].getY();
+}
+
+
 /* Returns the intersection of this polygon with polygon V. */
 Polygon Polygon::intersection(const Polygon& V) const {
-    vp ppoints = points;
-    vp vpoints = V.getPoints();
+    Span span("Polygon::intersection", buffer->size() + V.buffer->size());
+    const vp& ppoints = *buffer;
+    const vp& vpoints = V.getPoints();
+    // Rectangles (such as bounding boxes) are clipped in linear time.
+    if (is_rect(vpoints)) {
+        return from_hull(clip_rect(ppoints, vpoints[0].getX(), vpoints[0].getY(),
+                                   vpoints[2].getX(), vpoints[2].getY()));
+    }
+    if (is_rect(ppoints)) {
+        return from_hull(clip_rect(vpoints, ppoints[0].getX(), ppoints[0].getY(),
+                                   ppoints[2].getX(), ppoints[2].getY()));
+    }
     vp inter;
     inter_point(ppoints, vpoints, inter);
     inter_seg(ppoints, vpoints, inter);
@@ -275,8 +485,9 @@ Polygon Polygon::intersection(const Polygon& V) const {
 
 /* Returns the union of this polygon with polygon V. */
 Polygon Polygon::union_(const Polygon& V) const {
-    vp ppoints = points;
-    vp vpoints = V.getPoints();
+    Span span("Polygon::union_", buffer->size() + V.buffer->size());
+    vp ppoints = *buffer;
+    const vp& vpoints = V.getPoints();
     int n = vpoints.size();
     for(int i = 0; i < n; ++i) ppoints.push_back(vpoints[i]);
     Polygon W(ppoints);
@@ -286,10 +497,10 @@ Polygon Polygon::union_(const Polygon& V) const {
 
 /* Checks whether this polygon is inside polygon V. */
 bool Polygon::inside(const Polygon& V) const{
-    Polygon p1 = *this;
-    Polygon W = p1.union_(V);
-    vp w = W.getPoints();
-    vp v = V.getPoints();
+    Span span("Polygon::inside", buffer->size() + V.buffer->size());
+    Polygon W = union_(V);
+    const vp& w = W.getPoints();
+    const vp& v = V.getPoints();
     if (w.size() != v.size()) return false;
     else {
         int n = w.size();
@@ -301,6 +512,8 @@ bool Polygon::inside(const Polygon& V) const{
 
 /* Returns the bounding box of this polygon. */
 Polygon Polygon::bbox() const {
+    Span span("Polygon::bbox", buffer->size());
+    const vp& points = *buffer;
     int n = points.size();
     if (n < 2) return Polygon(points, c);
     else {
@@ -321,3 +534,396 @@ Polygon Polygon::bbox() const {
         return Polygon(p);
     }
 }
+
+
+/* Returns the clockwise angle of the vector (dx, dy) measured from
+   the positive Y axis, in [0, 2*pi). */
+static double cw_angle(double dx, double dy) {
+    double a = atan2(dx, dy);
+    return a < 0 ? a + 2*M_PI : a;
+}
+
+
+/* Returns the Minkowski sum of the convex polygons p and q, both given
+   clockwise from their leftmost and downmost points. Since the edges of
+   each polygon are sorted by angle, they are merged as in a merge sort. */
+static vp minkowski(const vp& p, const vp& q) {
+    int n = p.size();
+    int m = q.size();
+    if (n == 0 or m == 0) return vp();
+    // A single point has no edges.
+    int ne = (n > 1 ? n : 0);
+    int me = (m > 1 ? m : 0);
+    vp sum;
+    int i = 0, j = 0;
+    while (i < ne or j < me) {
+        sum.push_back(p[i%n] + q[j%m]);
+        if (i == ne) ++j;
+        else if (j == me) ++i;
+        else {
+            double a1 = cw_angle(p[(i+1)%n].getX() - p[i].getX(), p[(i+1)%n].getY() - p[i].getY());
+            double a2 = cw_angle(q[(j+1)%m].getX() - q[j].getX(), q[(j+1)%m].getY() - q[j].getY());
+            // Parallel edges are added together.
+            if (abs(a1 - a2) < 1e-12) ++i, ++j;
+            else if (a1 < a2) ++i;
+            else ++j;
+        }
+    }
+    if (sum.empty()) sum.push_back(p[0] + q[0]);
+    return sum;
+}
+
+
+/* Returns the Minkowski sum of this polygon with polygon V.
+   The edges of both convex hulls are merged in linear time. */
+Polygon Polygon::minkowskiSum(const Polygon& V) const {
+    Span span("Polygon::minkowskiSum", buffer->size() + V.buffer->size());
+    vp ppoints = *buffer;
+    vp vpoints = V.getPoints();
+    // Segments are not rotated by convexHull().
+    rotate_leftmost(ppoints);
+    rotate_leftmost(vpoints);
+    return from_hull(minkowski(ppoints, vpoints));
+}
+
+
+/* Returns the Minkowski difference of this polygon with polygon V,
+   that is, the Minkowski sum with V reflected through the origin. */
+Polygon Polygon::minkowskiDifference(const Polygon& V) const {
+    Span span("Polygon::minkowskiDifference", buffer->size() + V.buffer->size());
+    vp ppoints = *buffer;
+    vp vpoints = V.getPoints();
+    int m = vpoints.size();
+    for (int i = 0; i < m; ++i) vpoints[i] = Point(-vpoints[i].getX(), -vpoints[i].getY());
+    rotate_leftmost(ppoints);
+    rotate_leftmost(vpoints);
+    return from_hull(minkowski(ppoints, vpoints));
+}
+
+
+/* Returns the part of this polygon inside the half-plane h,
+   in a single pass over its vertices. */
+Polygon Polygon::clip(const HalfPlane& h) const {
+    Span span("Polygon::clip", buffer->size());
+    vp in;
+    split(*buffer, h, in, nullptr);
+    return from_hull(in, c);
+}
+
+
+/* Returns the part of this polygon inside the axis-aligned rectangle
+   [xmin, xmax] x [ymin, ymax], in linear time. */
+Polygon Polygon::clipRect(double xmin, double ymin, double xmax, double ymax) const {
+    Span span("Polygon::clipRect", buffer->size());
+    return from_hull(clip_rect(*buffer, xmin, ymin, xmax, ymax), c);
+}
+
+
+/* Coordinate of P along the cutting axis (x if by_x, y otherwise). */
+static double along(const Point& P, bool by_x) {
+    return by_x ? P.getX() : P.getY();
+}
+
+
+/* Coordinate of P across the cutting axis (y if by_x, x otherwise). */
+static double across(const Point& P, bool by_x) {
+    return by_x ? P.getY() : P.getX();
+}
+
+
+/* Returns the point of the chain at coordinate u along the axis, advancing
+   the index i of its current edge. The chain must be sorted along the axis.
+   On vertical steps, the upper chain takes the last point and the lower
+   chain the first one. */
+static Point chain_at(const vp& chain, int& i, double u, bool by_x, bool upper) {
+    int n = chain.size();
+    if (upper) while (i+1 < n and along(chain[i+1], by_x) <= u) ++i;
+    else while (i+1 < n and along(chain[i+1], by_x) < u) ++i;
+    double u0 = along(chain[i], by_x);
+    if (i+1 == n or u0 >= u) return chain[i];
+    double u1 = along(chain[i+1], by_x);
+    double t = (u - u0)/(u1 - u0);
+    double w = across(chain[i], by_x) + t*(across(chain[i+1], by_x) - across(chain[i], by_x));
+    return by_x ? Point(u, w) : Point(w, u);
+}
+
+
+/* Splits the convex polygon v into the slabs between consecutive cuts
+   (sorted lines x = cut if by_x, y = cut otherwise) in a single sweep:
+   v is divided into its upper and lower chains, which are walked once. */
+static vector <vp> slabs(const vp& v, const vector <double>& cuts, bool by_x) {
+    int k = int(cuts.size()) - 1;
+    vector <vp> pieces(max(k, 0));
+    if (v.size() < 3 or abs(signed_area2(v)) < 1e-12) {
+        // Points and segments are just clipped slab by slab.
+        for (int s = 0; s < k; ++s) {
+            HalfPlane lo = {by_x ? -1.0 : 0.0, by_x ? 0.0 : -1.0, -cuts[s]};
+            HalfPlane hi = {by_x ? 1.0 : 0.0, by_x ? 0.0 : 1.0, cuts[s+1]};
+            vp in;
+            split(v, lo, in, nullptr);
+            split(in, hi, pieces[s], nullptr);
+        }
+        return pieces;
+    }
+    // Start at the lowest point along the axis, with the chains ordered so
+    // that the "upper" one (greater across coordinate) comes first.
+    int n = v.size();
+    int first = 0, last = 0;
+    for (int i = 1; i < n; ++i) {
+        double u = along(v[i], by_x), w = across(v[i], by_x);
+        double uf = along(v[first], by_x), wf = across(v[first], by_x);
+        double ul = along(v[last], by_x), wl = across(v[last], by_x);
+        if (u < uf or (u == uf and w < wf)) first = i;
+        if (u > ul or (u == ul and w > wl)) last = i;
+    }
+    // Clockwise order walks the upper chain first in (x, y) coordinates,
+    // and counterclockwise order does it in (y, x) coordinates.
+    bool cw = signed_area2(v) < 0;
+    int step = (cw == by_x ? 1 : n-1);
+    vp upper, lower;
+    for (int i = first; i != last; i = (i + step)%n) upper.push_back(v[i]);
+    upper.push_back(v[last]);
+    for (int i = last; i != first; i = (i + step)%n) lower.push_back(v[i]);
+    lower.push_back(v[first]);
+    reverse(lower.begin(), lower.end());
+    double umin = along(v[first], by_x);
+    double umax = along(v[last], by_x);
+    int iu = 0, il = 0;
+    for (int s = 0; s < k; ++s) {
+        double l = max(cuts[s], umin);
+        double r = min(cuts[s+1], umax);
+        if (l >= r) continue;
+        vp& piece = pieces[s];
+        piece.push_back(chain_at(upper, iu, l, by_x, true));
+        for (int i = iu+1; i < int(upper.size()) and along(upper[i], by_x) < r; ++i) {
+            piece.push_back(upper[i]);
+        }
+        piece.push_back(chain_at(upper, iu, r, by_x, true));
+        Point L = chain_at(lower, il, l, by_x, false);
+        int ifirst = il+1;
+        Point R = chain_at(lower, il, r, by_x, false);
+        piece.push_back(R);
+        for (int i = il; i >= ifirst; --i) {
+            double u = along(lower[i], by_x);
+            if (u > l and u < r) piece.push_back(lower[i]);
+        }
+        piece.push_back(L);
+    }
+    return pieces;
+}
+
+
+/* Splits this polygon into a grid of cols x rows tiles of size w x h,
+   whose lower left corner is (x0, y0). The tiles are returned row by row,
+   from the lower one, and are computed in a single sweep over the polygon. */
+vector <Polygon> Polygon::tiles(double x0, double y0, double w, double h, int cols, int rows) const {
+    Span span("Polygon::tiles", buffer->size());
+    vector <Polygon> grid(size_t(max(cols, 0))*size_t(max(rows, 0)));
+    vector <double> xs, ys;
+    for (int i = 0; i <= cols; ++i) xs.push_back(x0 + i*w);
+    for (int j = 0; j <= rows; ++j) ys.push_back(y0 + j*h);
+    vector <vp> columns = slabs(*buffer, xs, true);
+    for (int i = 0; i < cols; ++i) {
+        if (columns[i].empty()) continue;
+        vector <vp> cells = slabs(from_hull(columns[i]).getPoints(), ys, false);
+        for (int j = 0; j < rows; ++j) grid[size_t(j)*cols + i] = from_hull(cells[j], c);
+    }
+    return grid;
+}
+
+
+/* Returns the distance from point P to the line through a and b. */
+static double line_distance(const Point& P, const Point& a, const Point& b) {
+    double dx = b.getX() - a.getX();
+    double dy = b.getY() - a.getY();
+    return abs(dx*(P.getY() - a.getY()) - dy*(P.getX() - a.getX()))/sqrt(dx*dx + dy*dy);
+}
+
+
+/* Returns the distance from point P to the segment ab. */
+static double segment_distance(const Point& P, const Point& a, const Point& b) {
+    double dx = b.getX() - a.getX();
+    double dy = b.getY() - a.getY();
+    double l2 = dx*dx + dy*dy;
+    double t = 0;
+    if (l2 > 0) t = ((P.getX() - a.getX())*dx + (P.getY() - a.getY())*dy)/l2;
+    t = max(0.0, min(1.0, t));
+    return P.distance(Point(a.getX() + t*dx, a.getY() + t*dy));
+}
+
+
+/* Tells whether the vectors ab and cd point to the same side (positive dot product). */
+static bool forward(const Point& a, const Point& b, const Point& c, const Point& d) {
+    return (b.getX() - a.getX())*(d.getX() - c.getX()) + (b.getY() - a.getY())*(d.getY() - c.getY()) > 0;
+}
+
+
+/* Returns the inner approximation of the convex polygon p (with at least 4
+   vertices) that keeps a subset of its vertices: from each kept vertex, the
+   next one is the farthest such that the skipped ones are within tol of the
+   chord. A chord only grows while the first and last skipped edges go forward
+   along it, so the skipped chain turns less than 180 degrees and all of it
+   projects onto the chord: the distance to the segment is then the distance
+   to the line, which is unimodal along the chain. So the farthest skipped
+   vertex only moves forward, and it takes O(n). */
+static vp inner_hull(const vp& p, double tol) {
+    int n = p.size();
+    vp hull;
+    int i = 0;
+    while (i < n) {
+        hull.push_back(p[i]);
+        int j = i + 1;
+        int f = i + 1;
+        // The chord from the first vertex cannot close the polygon.
+        int last = (i == 0 ? n-1 : n);
+        while (j + 1 <= last) {
+            const Point& b = p[(j+1)%n];
+            if (not forward(p[i], p[i+1], p[i], b) or not forward(p[j], b, p[i], b)) break;
+            while (f + 1 <= j and line_distance(p[f+1], p[i], b) >= line_distance(p[f], p[i], b)) ++f;
+            if (segment_distance(p[f], p[i], b) > tol) break;
+            ++j;
+        }
+        i = j;
+    }
+    // Adding vertices to an inner approximation does not increase its error.
+    if (hull.size() == 2) {
+        int far = 0;
+        for (int k = 1; k < n; ++k) {
+            if (segment_distance(p[k], hull[0], hull[1]) > segment_distance(p[far], hull[0], hull[1])) far = k;
+        }
+        hull.push_back(p[far]);
+    }
+    return hull;
+}
+
+
+/* Returns the outer approximation of the convex polygon p (with at least 4
+   vertices) that keeps the lines of a subset of its edges: from each kept
+   edge, the next one is the farthest such that the corner where both lines
+   meet is within tol of p. This corner is where the error is the largest.
+   The first kept edge is edge 0. */
+static vp outer_hull(const vp& p, double tol) {
+    int n = p.size();
+    vp corners;
+    int i = 0;
+    int q = 0;
+    while (i < n) {
+        const Point& a = p[i];
+        double dx = p[(i+1)%n].getX() - a.getX();
+        double dy = p[(i+1)%n].getY() - a.getY();
+        int j = i + 1;
+        Point corner = p[j%n];
+        while (j + 1 <= n) {
+            const Point& b = p[(j+1)%n];
+            double ex = p[(j+2)%n].getX() - b.getX();
+            double ey = p[(j+2)%n].getY() - b.getY();
+            double cross = dx*ey - dy*ex;
+            // The lines must turn clockwise by less than 180 degrees.
+            if (cross > -1e-12) break;
+            double alpha = ((b.getX() - a.getX())*ey - (b.getY() - a.getY())*ex)/cross;
+            Point X(a.getX() + alpha*dx, a.getY() + alpha*dy);
+            // The nearest skipped edge to X is found by hill climbing.
+            q = max(q, i + 1);
+            q = min(q, j);
+            while (q + 1 <= j and segment_distance(X, p[(q+1)%n], p[(q+2)%n]) <= segment_distance(X, p[q%n], p[(q+1)%n])) ++q;
+            while (q - 1 >= i + 1 and segment_distance(X, p[(q-1)%n], p[q%n]) < segment_distance(X, p[q%n], p[(q+1)%n])) --q;
+            if (segment_distance(X, p[q%n], p[(q+1)%n]) > tol) break;
+            corner = X;
+            ++j;
+        }
+        corners.push_back(corner);
+        i = j;
+    }
+    return corners;
+}
+
+
+/* Returns a convex approximation of this polygon on the given side,
+   whose Hausdorff distance to this polygon is at most tolerance. */
+Polygon Polygon::simplify(double tolerance, Approximation side) const {
+    Span span("Polygon::simplify", buffer->size());
+    const vp& points = *buffer;
+    if (points.size() < 4) return Polygon(points, c);
+    if (side == inner) return from_hull(inner_hull(points, tolerance), c);
+    return from_hull(outer_hull(points, tolerance), c);
+}
+
+
+/* Returns the vertices of the convex polygon p starting at vertex s. */
+static vp rotated(const vp& p, int s) {
+    vp r(p.begin() + s, p.end());
+    r.insert(r.end(), p.begin(), p.begin() + s);
+    return r;
+}
+
+
+/* Returns an edge of the convex polygon p (with at least 4 vertices) from
+   which outer_hull() with tolerance tol keeps at most k edges, or -1 if
+   there is none. Edge 0 is tried first, and the rest only if it fails,
+   which takes O(n^2). */
+static int outer_start(const vp& p, double tol, int k) {
+    int n = p.size();
+    for (int s = 0; s < n; ++s) {
+        if ((int)outer_hull(rotated(p, s), tol).size() <= k) return s;
+    }
+    return -1;
+}
+
+
+/* Returns a convex approximation of this polygon on the given side with
+   at most max_vertices vertices (but no less than 3), with the smallest
+   tolerance found by bisection. Outer approximations keep edge lines of
+   this polygon, so some polygons (such as a square for 3 vertices) have
+   none: then the one with the fewest vertices found is returned. */
+Polygon Polygon::simplifyVertices(int max_vertices, Approximation side) const {
+    Span span("Polygon::simplifyVertices", buffer->size());
+    int k = max(max_vertices, 3);
+    if (vertices() <= k) return from_hull(*buffer, c);
+    double lo = 0;
+    double hi = 2*(width() + height());
+    // The greedy outer approximation depends on its first edge, which is
+    // chosen so that some tolerance gives at most k vertices. Its corners
+    // can be far away when edges are almost parallel.
+    vp points = *buffer;
+    int start = side == outer ? outer_start(points, numeric_limits<double>::infinity(), k) : 0;
+    points = rotated(points, max(start, 0));
+    auto approximation = [&](double tol) {
+        if (side == inner) return from_hull(inner_hull(points, tol), c);
+        return from_hull(outer_hull(points, tol), c);
+    };
+    Polygon best = approximation(hi);
+    while (start >= 0 and best.vertices() > k) {
+        hi *= 2;
+        best = approximation(hi);
+    }
+    for (int it = 0; it < 60 and hi - lo > 1e-9*hi; ++it) {
+        double mid = (lo + hi)/2;
+        Polygon P = approximation(mid);
+        if (P.vertices() <= k) {
+            best = P;
+            hi = mid;
+        } else lo = mid;
+    }
+    return best;
+}
+
+
+/* Stores the levels of detail of this polygon: one approximation on the
+   given side for each tolerance, from the coarsest to the finest. */
+void Polygon::setLevels(vector <double> tolerances, Approximation side) {
+    sort(tolerances.begin(), tolerances.end(), greater<double>());
+    lods = make_shared<vector <vp>>();
+    for (double t : tolerances) lods->push_back(simplify(t, side).getPoints());
+}
+
+
+/* Returns the number of levels of detail of this polygon. */
+int Polygon::levels() const {
+    return lods ? lods->size() : 0;
+}
+
+
+/* Returns the level of detail i of this polygon (0 is the coarsest). */
+Polygon Polygon::level(int i) const {
+    return from_hull((*lods)[i], c);
+}
@@ -4,20 +4,28 @@
 
 #include "Point.hh"
 #include "Color.hh"
+#include "HalfPlane.hh"
 
 #include <vector>
+#include <memory>
 using namespace std;
 
 
 /* The Polygon class stores a two dimensional polygon in the plane,
  * formed by two dimensional points (cfc. class Point),and provides 
  * some usefull operations for it.
+ * Copies of a polygon share its vector of points until one of them
+ * modifies it (copy on write), so copying a polygon takes O(1) time.
 */
 
 class Polygon {
 
     public:
 
+    /* Side of a convex approximation of a polygon: inner approximations
+       are contained in the polygon and outer approximations contain it. */
+    enum Approximation { inner, outer };
+
     /* Constructor:
        Creates a polygon with its vector of points (vertices) "points" and color "c".
        The points vector is optional and defaults to an empty vector.
@@ -25,8 +33,15 @@ class Polygon {
        The vector of points is updated to its convex hull. */
     Polygon(const vector <Point>& points = {}, Color c = {0, 0, 0});
 
+    /* Constructor:
+       Creates the polygon formed by the intersection of the half-planes "H",
+       with color "c", in O(n log n) time. The vertices are already computed
+       in convex order, so no convex hull is needed. Unbounded intersections
+       are limited to the square |x|, |y| <= 1e9. */
+    Polygon(const vector <HalfPlane>& H, Color c = {0, 0, 0});
+
     /* Gets the vector of points of this polygon. */
-    vector <Point> getPoints() const;
+    const vector <Point>& getPoints() const;
 
     /* Gets the color of this polygon. */
     Color getcol() const;
@@ -70,14 +85,60 @@ class Polygon {
     /* Returns the bounding box of this polygon. */
     Polygon bbox() const;
 
+    /* Returns the Minkowski sum of this polygon with polygon V.
+       The edges of both convex hulls are merged in linear time. */
+    Polygon minkowskiSum(const Polygon& V) const;
+
+    /* Returns the Minkowski difference of this polygon with polygon V,
+       that is, the Minkowski sum with V reflected through the origin. */
+    Polygon minkowskiDifference(const Polygon& V) const;
+
+    /* Returns the part of this polygon inside the half-plane h,
+       in a single pass over its vertices. */
+    Polygon clip(const HalfPlane& h) const;
+
+    /* Returns the part of this polygon inside the axis-aligned rectangle
+       [xmin, xmax] x [ymin, ymax], in linear time. */
+    Polygon clipRect(double xmin, double ymin, double xmax, double ymax) const;
+
+    /* Splits this polygon into a grid of cols x rows tiles of size w x h,
+       whose lower left corner is (x0, y0). The tiles are returned row by row,
+       from the lower one, and are computed in a single sweep over the polygon. */
+    vector <Polygon> tiles(double x0, double y0, double w, double h, int cols, int rows) const;
+
+    /* Returns a convex approximation of this polygon on the given side,
+       whose Hausdorff distance to this polygon is at most tolerance. */
+    Polygon simplify(double tolerance, Approximation side) const;
+
+    /* Returns a convex approximation of this polygon on the given side with
+       at most max_vertices vertices (but no less than 3), with the smallest
+       tolerance found by bisection. Outer approximations keep edge lines of
+       this polygon, so some polygons (such as a square for 3 vertices) have
+       none: then the one with the fewest vertices found is returned. */
+    Polygon simplifyVertices(int max_vertices, Approximation side) const;
+
+    /* Stores the levels of detail of this polygon: one approximation on the
+       given side for each tolerance, from the coarsest to the finest. */
+    void setLevels(vector <double> tolerances, Approximation side);
+
+    /* Returns the number of levels of detail of this polygon. */
+    int levels() const;
+
+    /* Returns the level of detail i of this polygon (0 is the coarsest). */
+    Polygon level(int i) const;
+
     private:
 
-    /* Vector of points of the polygon. */
-    vector <Point> points;
+    /* Vector of points of the polygon, shared with its copies. */
+    shared_ptr <vector <Point>> buffer;
 
     /* Color of the polygon. */
     Color c;
 
+    /* Vertices of the levels of detail of the polygon, from the coarsest,
+       shared with its copies (null if there are none). */
+    shared_ptr <vector <vector <Point>>> lods;
+
     /* Comparison for sorting "points". */
     struct Comp;
 
@@ -85,9 +146,17 @@ class Polygon {
        point with lower X (and with lower Y in case of ties). */
     void sorting_slope(vector <Point>& points);
 
+    /* Gets the vector of points of this polygon for writing,
+       copying it first if it is shared with other polygons. */
+    vector <Point>& writable_points();
+
     /* Updates the vector of points to its convex hull. */
     void convexHull ();
 
+    /* Creates a polygon from points that are already in convex order,
+       without computing their convex hull again. */
+    static Polygon from_hull(const vector <Point>& hull, Color c = {0, 0, 0});
+
 };
 
 
@@ -0,0 +1,433 @@
+#include "PolygonSet.hh"
+#include "Point.hh"
+#include "Polygon.hh"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) and defined(__GNUC__)
+#include <immintrin.h>
+#define POLYGONSET_AVX2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define POLYGONSET_NEON
+#endif
+
+using namespace std;
+
+
+/* Computes, for every position i of x and y but the last one, the cross
+   product of vertex i and vertex i+1. */
+static void cross_scalar(const double* x, const double* y, int n, double* cross) {
+    for (int i = 0; i + 1 < n; ++i) cross[i] = x[i]*y[i+1] - x[i+1]*y[i];
+}
+
+
+/* Computes, for every position i of x and y but the last one, the length
+   of the segment from vertex i to vertex i+1. */
+static void length_scalar(const double* x, const double* y, int n, double* len) {
+    for (int i = 0; i + 1 < n; ++i) {
+        double dx = x[i+1] - x[i];
+        double dy = y[i+1] - y[i];
+        len[i] = sqrt(dx*dx + dy*dy);
+    }
+}
+
+
+/* Adds to the sums and updates the bounds with the vertices in [b, e). */
+static void range_scalar(const double* x, const double* y, int b, int e,
+                         double& sx, double& sy, double& xmin, double& ymin, double& xmax, double& ymax) {
+    for (int i = b; i < e; ++i) {
+        sx += x[i];
+        sy += y[i];
+        xmin = min(xmin, x[i]);
+        ymin = min(ymin, y[i]);
+        xmax = max(xmax, x[i]);
+        ymax = max(ymax, y[i]);
+    }
+}
+
+
+/* Adds to the sums and updates the bounds of m polygons, polygon j having
+   the vertices in [b[j], e[j]). */
+static void ranges_scalar(const double* x, const double* y, const int* b, const int* e, int m,
+                          double* sx, double* sy, double* xmin, double* ymin, double* xmax, double* ymax) {
+    for (int j = 0; j < m; ++j) range_scalar(x, y, b[j], e[j], sx[j], sy[j], xmin[j], ymin[j], xmax[j], ymax[j]);
+}
+
+
+#ifdef POLYGONSET_AVX2
+
+/* AVX2 version of cross_scalar(), four segments at a time. */
+__attribute__((target("avx2")))
+static void cross_avx2(const double* x, const double* y, int n, double* cross) {
+    int i = 0;
+    for (; i + 4 < n; i += 4) {
+        __m256d x0 = _mm256_loadu_pd(x + i), x1 = _mm256_loadu_pd(x + i + 1);
+        __m256d y0 = _mm256_loadu_pd(y + i), y1 = _mm256_loadu_pd(y + i + 1);
+        _mm256_storeu_pd(cross + i, _mm256_sub_pd(_mm256_mul_pd(x0, y1), _mm256_mul_pd(x1, y0)));
+    }
+    cross_scalar(x + i, y + i, n - i, cross + i);
+}
+
+
+/* AVX2 version of length_scalar(), four segments at a time. */
+__attribute__((target("avx2")))
+static void length_avx2(const double* x, const double* y, int n, double* len) {
+    int i = 0;
+    for (; i + 4 < n; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i + 1), _mm256_loadu_pd(x + i));
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i + 1), _mm256_loadu_pd(y + i));
+        _mm256_storeu_pd(len + i, _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy))));
+    }
+    length_scalar(x + i, y + i, n - i, len + i);
+}
+
+
+/* AVX2 version of range_scalar(), four vertices at a time. */
+__attribute__((target("avx2")))
+static void range_avx2(const double* x, const double* y, int b, int e,
+                       double& sx, double& sy, double& xmin, double& ymin, double& xmax, double& ymax) {
+    if (e - b < 8) return range_scalar(x, y, b, e, sx, sy, xmin, ymin, xmax, ymax);
+    __m256d vsx = _mm256_setzero_pd(), vsy = _mm256_setzero_pd();
+    __m256d vxmin = _mm256_set1_pd(xmin), vymin = _mm256_set1_pd(ymin);
+    __m256d vxmax = _mm256_set1_pd(xmax), vymax = _mm256_set1_pd(ymax);
+    int i = b;
+    for (; i + 4 <= e; i += 4) {
+        __m256d vx = _mm256_loadu_pd(x + i), vy = _mm256_loadu_pd(y + i);
+        vsx = _mm256_add_pd(vsx, vx);
+        vsy = _mm256_add_pd(vsy, vy);
+        vxmin = _mm256_min_pd(vxmin, vx);
+        vymin = _mm256_min_pd(vymin, vy);
+        vxmax = _mm256_max_pd(vxmax, vx);
+        vymax = _mm256_max_pd(vymax, vy);
+    }
+    double t[4];
+    _mm256_storeu_pd(t, vsx); sx += t[0] + t[1] + t[2] + t[3];
+    _mm256_storeu_pd(t, vsy); sy += t[0] + t[1] + t[2] + t[3];
+    _mm256_storeu_pd(t, vxmin); xmin = min(min(t[0], t[1]), min(t[2], t[3]));
+    _mm256_storeu_pd(t, vymin); ymin = min(min(t[0], t[1]), min(t[2], t[3]));
+    _mm256_storeu_pd(t, vxmax); xmax = max(max(t[0], t[1]), max(t[2], t[3]));
+    _mm256_storeu_pd(t, vymax); ymax = max(max(t[0], t[1]), max(t[2], t[3]));
+    range_scalar(x, y, i, e, sx, sy, xmin, ymin, xmax, ymax);
+}
+
+
+/* AVX2 version of ranges_scalar(), four polygons at a time (one in each
+   lane), which pays off for small polygons. Every polygon has at least one
+   vertex. */
+__attribute__((target("avx2")))
+static void ranges_avx2(const double* x, const double* y, const int* b, const int* e, int m,
+                        double* sx, double* sy, double* xmin, double* ymin, double* xmax, double* ymax) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    int j = 0;
+    for (; j + 4 <= m; j += 4) {
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i ve = _mm_loadu_si128((const __m128i*)(e + j));
+        __m128i last = _mm_sub_epi32(ve, _mm_set1_epi32(1));
+        int n = 0;
+        for (int k = j; k < j + 4; ++k) n = max(n, e[k] - b[k]);
+        __m256d vsx = _mm256_loadu_pd(sx + j), vsy = _mm256_loadu_pd(sy + j);
+        __m256d vxmin = _mm256_loadu_pd(xmin + j), vymin = _mm256_loadu_pd(ymin + j);
+        __m256d vxmax = _mm256_loadu_pd(xmax + j), vymax = _mm256_loadu_pd(ymax + j);
+        for (int i = 0; i < n; ++i) {
+            __m128i vi = _mm_add_epi32(vb, _mm_set1_epi32(i));
+            // Lanes past their last vertex read it again, which does not
+            // change the bounds, and add nothing to the sums.
+            __m128i index = _mm_min_epi32(vi, last);
+            __m256d in = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmplt_epi32(vi, ve)));
+            __m256d vx = _mm256_mask_i32gather_pd(zero, x, index, all, 8);
+            __m256d vy = _mm256_mask_i32gather_pd(zero, y, index, all, 8);
+            vsx = _mm256_add_pd(vsx, _mm256_and_pd(vx, in));
+            vsy = _mm256_add_pd(vsy, _mm256_and_pd(vy, in));
+            vxmin = _mm256_min_pd(vxmin, vx);
+            vymin = _mm256_min_pd(vymin, vy);
+            vxmax = _mm256_max_pd(vxmax, vx);
+            vymax = _mm256_max_pd(vymax, vy);
+        }
+        _mm256_storeu_pd(sx + j, vsx);
+        _mm256_storeu_pd(sy + j, vsy);
+        _mm256_storeu_pd(xmin + j, vxmin);
+        _mm256_storeu_pd(ymin + j, vymin);
+        _mm256_storeu_pd(xmax + j, vxmax);
+        _mm256_storeu_pd(ymax + j, vymax);
+    }
+    ranges_scalar(x, y, b + j, e + j, m - j, sx + j, sy + j, xmin + j, ymin + j, xmax + j, ymax + j);
+}
+
+#endif
+
+
+#ifdef POLYGONSET_NEON
+
+/* NEON version of cross_scalar(), two segments at a time. */
+static void cross_neon(const double* x, const double* y, int n, double* cross) {
+    int i = 0;
+    for (; i + 2 < n; i += 2) {
+        float64x2_t x0 = vld1q_f64(x + i), x1 = vld1q_f64(x + i + 1);
+        float64x2_t y0 = vld1q_f64(y + i), y1 = vld1q_f64(y + i + 1);
+        vst1q_f64(cross + i, vsubq_f64(vmulq_f64(x0, y1), vmulq_f64(x1, y0)));
+    }
+    cross_scalar(x + i, y + i, n - i, cross + i);
+}
+
+
+/* NEON version of length_scalar(), two segments at a time. */
+static void length_neon(const double* x, const double* y, int n, double* len) {
+    int i = 0;
+    for (; i + 2 < n; i += 2) {
+        float64x2_t dx = vsubq_f64(vld1q_f64(x + i + 1), vld1q_f64(x + i));
+        float64x2_t dy = vsubq_f64(vld1q_f64(y + i + 1), vld1q_f64(y + i));
+        vst1q_f64(len + i, vsqrtq_f64(vaddq_f64(vmulq_f64(dx, dx), vmulq_f64(dy, dy))));
+    }
+    length_scalar(x + i, y + i, n - i, len + i);
+}
+
+
+/* NEON version of range_scalar(), two vertices at a time. */
+static void range_neon(const double* x, const double* y, int b, int e,
+                       double& sx, double& sy, double& xmin, double& ymin, double& xmax, double& ymax) {
+    if (e - b < 4) return range_scalar(x, y, b, e, sx, sy, xmin, ymin, xmax, ymax);
+    float64x2_t vsx = vdupq_n_f64(0), vsy = vdupq_n_f64(0);
+    float64x2_t vxmin = vdupq_n_f64(xmin), vymin = vdupq_n_f64(ymin);
+    float64x2_t vxmax = vdupq_n_f64(xmax), vymax = vdupq_n_f64(ymax);
+    int i = b;
+    for (; i + 2 <= e; i += 2) {
+        float64x2_t vx = vld1q_f64(x + i), vy = vld1q_f64(y + i);
+        vsx = vaddq_f64(vsx, vx);
+        vsy = vaddq_f64(vsy, vy);
+        vxmin = vminq_f64(vxmin, vx);
+        vymin = vminq_f64(vymin, vy);
+        vxmax = vmaxq_f64(vxmax, vx);
+        vymax = vmaxq_f64(vymax, vy);
+    }
+    sx += vaddvq_f64(vsx);
+    sy += vaddvq_f64(vsy);
+    xmin = vminvq_f64(vxmin);
+    ymin = vminvq_f64(vymin);
+    xmax = vmaxvq_f64(vxmax);
+    ymax = vmaxvq_f64(vymax);
+    range_scalar(x, y, i, e, sx, sy, xmin, ymin, xmax, ymax);
+}
+
+
+/* NEON version of ranges_scalar(), two polygons at a time (one in each
+   lane). Every polygon has at least one vertex. */
+static void ranges_neon(const double* x, const double* y, const int* b, const int* e, int m,
+                        double* sx, double* sy, double* xmin, double* ymin, double* xmax, double* ymax) {
+    int j = 0;
+    for (; j + 2 <= m; j += 2) {
+        int n = max(e[j] - b[j], e[j+1] - b[j+1]);
+        float64x2_t vsx = vld1q_f64(sx + j), vsy = vld1q_f64(sy + j);
+        float64x2_t vxmin = vld1q_f64(xmin + j), vymin = vld1q_f64(ymin + j);
+        float64x2_t vxmax = vld1q_f64(xmax + j), vymax = vld1q_f64(ymax + j);
+        for (int i = 0; i < n; ++i) {
+            // Lanes past their last vertex read it again, which does not
+            // change the bounds, and add nothing to the sums.
+            int i0 = min(b[j] + i, e[j] - 1), i1 = min(b[j+1] + i, e[j+1] - 1);
+            float64x2_t vx = vsetq_lane_f64(x[i1], vdupq_n_f64(x[i0]), 1);
+            float64x2_t vy = vsetq_lane_f64(y[i1], vdupq_n_f64(y[i0]), 1);
+            uint64x2_t in = vsetq_lane_u64(b[j+1] + i < e[j+1] ? ~0ULL : 0, vdupq_n_u64(b[j] + i < e[j] ? ~0ULL : 0), 1);
+            vsx = vaddq_f64(vsx, vbslq_f64(in, vx, vdupq_n_f64(0)));
+            vsy = vaddq_f64(vsy, vbslq_f64(in, vy, vdupq_n_f64(0)));
+            vxmin = vminq_f64(vxmin, vx);
+            vymin = vminq_f64(vymin, vy);
+            vxmax = vmaxq_f64(vxmax, vx);
+            vymax = vmaxq_f64(vymax, vy);
+        }
+        vst1q_f64(sx + j, vsx);
+        vst1q_f64(sy + j, vsy);
+        vst1q_f64(xmin + j, vxmin);
+        vst1q_f64(ymin + j, vymin);
+        vst1q_f64(xmax + j, vxmax);
+        vst1q_f64(ymax + j, vymax);
+    }
+    ranges_scalar(x, y, b + j, e + j, m - j, sx + j, sy + j, xmin + j, ymin + j, xmax + j, ymax + j);
+}
+
+#endif
+
+
+/* Computes the cross products of the segments between consecutive
+   positions, with the best kernel for this processor. */
+static void cross(const double* x, const double* y, int n, double* cross) {
+#if defined(POLYGONSET_AVX2)
+    if (__builtin_cpu_supports("avx2")) return cross_avx2(x, y, n, cross);
+#elif defined(POLYGONSET_NEON)
+    return cross_neon(x, y, n, cross);
+#endif
+    cross_scalar(x, y, n, cross);
+}
+
+
+/* Computes the lengths of the segments between consecutive positions,
+   with the best kernel for this processor. */
+static void length(const double* x, const double* y, int n, double* len) {
+#if defined(POLYGONSET_AVX2)
+    if (__builtin_cpu_supports("avx2")) return length_avx2(x, y, n, len);
+#elif defined(POLYGONSET_NEON)
+    return length_neon(x, y, n, len);
+#endif
+    length_scalar(x, y, n, len);
+}
+
+
+/* Returns, for each polygon, the sum of the terms that kernel gives to its
+   segments. The terms are computed for groups of whole polygons that fit
+   in a small block, so they stay in the cache until they are added. */
+static vector <double> segment_sums(const vector <double>& x, const vector <double>& y, const vector <int>& offset,
+                                    void (*kernel)(const double*, const double*, int, double*)) {
+    const int block = 2048;
+    vector <double> term(block);
+    int K = int(offset.size()) - 1;
+    vector <double> sums(K, 0);
+    int k0 = 0;
+    while (k0 < K) {
+        int k1 = k0 + 1;
+        while (k1 < K and offset[k1+1] - offset[k0] <= block) ++k1;
+        int b = offset[k0];
+        int n = offset[k1] - b;
+        if (n > int(term.size())) term.resize(n);
+        kernel(x.data() + b, y.data() + b, n, term.data());
+        for (int k = k0; k < k1; ++k) {
+            // The segment from the last position of a polygon is skipped.
+            double sum = 0;
+            for (int i = offset[k]; i + 1 < offset[k+1]; ++i) sum += term[i - b];
+            sums[k] = sum;
+        }
+        k0 = k1;
+    }
+    return sums;
+}
+
+
+/* Adds to the sums and updates the bounds with the vertices in [b, e),
+   with the best kernel for this processor. */
+static void range(const double* x, const double* y, int b, int e,
+                  double& sx, double& sy, double& xmin, double& ymin, double& xmax, double& ymax) {
+#if defined(POLYGONSET_AVX2)
+    if (__builtin_cpu_supports("avx2")) return range_avx2(x, y, b, e, sx, sy, xmin, ymin, xmax, ymax);
+#elif defined(POLYGONSET_NEON)
+    return range_neon(x, y, b, e, sx, sy, xmin, ymin, xmax, ymax);
+#endif
+    range_scalar(x, y, b, e, sx, sy, xmin, ymin, xmax, ymax);
+}
+
+
+/* Adds to the sums and updates the bounds of m polygons, with the best
+   kernel for this processor. */
+static void ranges(const double* x, const double* y, const int* b, const int* e, int m,
+                   double* sx, double* sy, double* xmin, double* ymin, double* xmax, double* ymax) {
+#if defined(POLYGONSET_AVX2)
+    if (__builtin_cpu_supports("avx2")) return ranges_avx2(x, y, b, e, m, sx, sy, xmin, ymin, xmax, ymax);
+#elif defined(POLYGONSET_NEON)
+    return ranges_neon(x, y, b, e, m, sx, sy, xmin, ymin, xmax, ymax);
+#endif
+    ranges_scalar(x, y, b, e, m, sx, sy, xmin, ymin, xmax, ymax);
+}
+
+
+/* Computes, for each polygon, the sums and the bounds of its vertices.
+   Polygons with fewer than "small" vertices are too short for the kernel
+   of a single polygon, so they are done together, one in each lane. */
+static void all_ranges(const vector <double>& x, const vector <double>& y, const vector <int>& offset,
+                       vector <double>& sx, vector <double>& sy, vector <double>& xmin,
+                       vector <double>& ymin, vector <double>& xmax, vector <double>& ymax) {
+    const int small = 8;
+    int K = int(offset.size()) - 1;
+    sx.assign(K, 0);
+    sy.assign(K, 0);
+    xmin.assign(K, HUGE_VAL);
+    ymin.assign(K, HUGE_VAL);
+    xmax.assign(K, -HUGE_VAL);
+    ymax.assign(K, -HUGE_VAL);
+    vector <int> k, b, e;
+    for (int i = 0; i < K; ++i) {
+        int n = max(offset[i+1] - offset[i] - 1, 0);
+        if (n > 0 and n < small) {
+            k.push_back(i);
+            b.push_back(offset[i]);
+            e.push_back(offset[i] + n);
+        } else range(x.data(), y.data(), offset[i], offset[i] + n, sx[i], sy[i], xmin[i], ymin[i], xmax[i], ymax[i]);
+    }
+    int m = k.size();
+    vector <double> ssx(m, 0), ssy(m, 0), sxmin(m, HUGE_VAL), symin(m, HUGE_VAL), sxmax(m, -HUGE_VAL), symax(m, -HUGE_VAL);
+    ranges(x.data(), y.data(), b.data(), e.data(), m, ssx.data(), ssy.data(), sxmin.data(), symin.data(), sxmax.data(), symax.data());
+    for (int j = 0; j < m; ++j) {
+        sx[k[j]] = ssx[j];
+        sy[k[j]] = ssy[j];
+        xmin[k[j]] = sxmin[j];
+        ymin[k[j]] = symin[j];
+        xmax[k[j]] = sxmax[j];
+        ymax[k[j]] = symax[j];
+    }
+}
+
+
+/* Constructor:
+Creates an empty set. */
+PolygonSet::PolygonSet()
+:     offset(1, 0) {}
+
+
+/* Adds polygon P at the end of the set. */
+void PolygonSet::add(const Polygon& P) {
+    const vector <Point>& points = P.getPoints();
+    for (const Point& Q : points) {
+        x.push_back(Q.getX());
+        y.push_back(Q.getY());
+    }
+    if (not points.empty()) {
+        x.push_back(points[0].getX());
+        y.push_back(points[0].getY());
+    }
+    offset.push_back(x.size());
+}
+
+
+/* Returns the number of polygons of the set. */
+int PolygonSet::size() const {
+    return int(offset.size()) - 1;
+}
+
+
+/* Returns the number of vertices of polygon i of the set. */
+int PolygonSet::vertices(int i) const {
+    return max(offset[i+1] - offset[i] - 1, 0);
+}
+
+
+/* Returns the areas of all the polygons of the set. */
+vector <double> PolygonSet::areas() const {
+    // We use shoelace formula.
+    vector <double> area = segment_sums(x, y, offset, cross);
+    for (double& a : area) a = abs(a)/2;
+    return area;
+}
+
+
+/* Returns the perimeters of all the polygons of the set. */
+vector <double> PolygonSet::perimeters() const {
+    return segment_sums(x, y, offset, length);
+}
+
+
+/* Returns the centroids of all the polygons of the set
+   (the mean of their vertices, as Polygon::centroid()). */
+vector <Point> PolygonSet::centroids() const {
+    vector <double> sx, sy, xmin, ymin, xmax, ymax;
+    all_ranges(x, y, offset, sx, sy, xmin, ymin, xmax, ymax);
+    vector <Point> centroid(size());
+    for (int k = 0; k < size(); ++k) centroid[k] = Point(sx[k]/vertices(k), sy[k]/vertices(k));
+    return centroid;
+}
+
+
+/* Computes the bounding boxes of all the polygons of the set. */
+void PolygonSet::bboxes(vector <double>& xmin, vector <double>& ymin,
+                        vector <double>& xmax, vector <double>& ymax) const {
+    vector <double> sx, sy;
+    all_ranges(x, y, offset, sx, sy, xmin, ymin, xmax, ymax);
+}
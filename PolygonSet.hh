@@ -0,0 +1,64 @@
+#ifndef PolygonSet_hh
+#define PolygonSet_hh
+
+
+#include "Point.hh"
+#include "Polygon.hh"
+
+#include <vector>
+using namespace std;
+
+
+/* The PolygonSet class stores many polygons (cfc. class Polygon) as a
+ * structure of arrays: the coordinates of all their vertices are kept in
+ * two contiguous arrays (x and y), each polygon followed by its first
+ * vertex again, and an offset table tells where each polygon starts.
+ * This lets the metrics of the whole set be computed in a single pass,
+ * with SIMD kernels (AVX2 or NEON, with a scalar fallback) that work
+ * across polygon boundaries.
+*/
+
+class PolygonSet {
+
+    public:
+
+    /* Constructor:
+       Creates an empty set. */
+    PolygonSet();
+
+    /* Adds polygon P at the end of the set. */
+    void add(const Polygon& P);
+
+    /* Returns the number of polygons of the set. */
+    int size() const;
+
+    /* Returns the number of vertices of polygon i of the set. */
+    int vertices(int i) const;
+
+    /* Returns the areas of all the polygons of the set. */
+    vector <double> areas() const;
+
+    /* Returns the perimeters of all the polygons of the set. */
+    vector <double> perimeters() const;
+
+    /* Returns the centroids of all the polygons of the set
+       (the mean of their vertices, as Polygon::centroid()). */
+    vector <Point> centroids() const;
+
+    /* Computes the bounding boxes of all the polygons of the set. */
+    void bboxes(vector <double>& xmin, vector <double>& ymin,
+                vector <double>& xmax, vector <double>& ymax) const;
+
+    private:
+
+    /* Coordinates of the vertices of all the polygons. */
+    vector <double> x, y;
+
+    /* Polygon i takes positions [offset[i], offset[i+1]) of x and y,
+       the last one being its first vertex again. */
+    vector <int> offset;
+
+};
+
+
+#endif
@@ -0,0 +1,138 @@
+#include "Renderer.hh"
+#include "Polygon.hh"
+#include "Point.hh"
+#include "Color.hh"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <pngwriter.h>
+using namespace std;
+
+using vp = vector <Point>;
+
+
+/* Tells whether the polygons can be drawn: there is at least one, and none
+of them is empty. */
+static bool drawable(const vector <Polygon>& polygons) {
+    if (polygons.empty()) return false;
+    for (const Polygon& P : polygons) if (P.vertices() == 0) return false;
+    return true;
+}
+
+
+/* Constructor:
+Creates a renderer with "threads" workers (0 means as many as the
+hardware supports). Workers are started by the first job. */
+Renderer::Renderer(int threads)
+:     threads(threads > 0 ? threads : max(1, int(thread::hardware_concurrency()))),
+      next(1), stop(false) {}
+
+
+/* Destructor:
+Finishes all the queued jobs. */
+Renderer::~Renderer() {
+    {
+        lock_guard <mutex> guard(lock);
+        stop = true;
+    }
+    queued.notify_all();
+    for (thread& t : workers) t.join();
+}
+
+
+/* Queues a job of the given client that draws the polygons into the
+given image file and returns its identifier, or -1 if the polygons
+cannot be drawn (cfc. render()). */
+int Renderer::submit(int client, const string& image, const vector <Polygon>& polygons) {
+    if (not drawable(polygons)) return -1;
+    lock_guard <mutex> guard(lock);
+    if (workers.empty()) {
+        for (int i = 0; i < threads; ++i) workers.push_back(thread(&Renderer::work, this));
+    }
+    int id = next++;
+    queue.push_back({id, client, image, polygons, Clock::now()});
+    ++clients[client].pending;
+    queued.notify_one();
+    return id;
+}
+
+
+/* Waits for all the jobs of the client and returns the timing of its
+jobs finished since the last call, in order of submission. */
+vector <Renderer::Job> Renderer::wait(int client) {
+    unique_lock <mutex> guard(lock);
+    idle.wait(guard, [this, client] { return clients[client].pending == 0; });
+    vector <Job> jobs;
+    jobs.swap(clients[client].finished);
+    clients.erase(client);
+    sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.id < b.id; });
+    return jobs;
+}
+
+
+/* Renders queued jobs until the renderer is destroyed. */
+void Renderer::work() {
+    unique_lock <mutex> guard(lock);
+    while (true) {
+        queued.wait(guard, [this] { return stop or not queue.empty(); });
+        if (queue.empty()) return;
+        Task task = move(queue.front());
+        queue.pop_front();
+        guard.unlock();
+        Clock::time_point start = Clock::now();
+        render(task.image, task.polygons);
+        Clock::time_point end = Clock::now();
+        guard.lock();
+        Client& c = clients[task.client];
+        c.finished.push_back({task.id, task.image,
+                              chrono::duration <double, milli>(start - task.submitted).count(),
+                              chrono::duration <double, milli>(end - start).count()});
+        if (--c.pending == 0) idle.notify_all();
+    }
+}
+
+
+/* Draws the polygons into the given image file (of size×size pixels),
+scaled to fit their bounding box. Returns false, without writing the
+file, if there are no polygons or some of them is empty. */
+bool Renderer::render(const string& image, const vector <Polygon>& polygons, int size) {
+    if (not drawable(polygons)) return false;
+    // create a png variable that denotes a size×size white canvas named image
+    pngwriter png(size, size, 1.0, image.c_str());
+    Polygon Box;
+    for (int i = 0; i < (int)polygons.size(); ++i) {
+        Box = Box.union_(polygons[i]);
+    }
+    Box = Box.bbox();
+    const vp& pBox = Box.getPoints();
+    double width = Box.width();
+    double height = Box.height();
+    double scale = (height > width ? height : width);
+    scale = (size - 2)/scale;
+    for (int i = 0; i < (int)polygons.size(); ++i) {
+        const vp& points = polygons[i].getPoints();
+        Color c = polygons[i].getcol();
+        vector <int> scaled = {};
+        int n = points.size(), x, y;
+        for (int i = 0; i < n; ++i) {
+            x = int((points[i].getX() - pBox[0].getX())*scale)+1;
+            y = int((points[i].getY() - pBox[0].getY())*scale)+1;
+            scaled.push_back(x);
+            scaled.push_back(y);
+        }
+        x = int((points[0].getX() - pBox[0].getX())*scale)+1;
+        y = int((points[0].getY() - pBox[0].getY())*scale)+1;
+        scaled.push_back(x);
+        scaled.push_back(y);
+        png.polygon(scaled.data(), (int)scaled.size()/2, c.R, c.G, c.B);
+    }
+    png.close();
+    return true;
+}
@@ -0,0 +1,116 @@
+#ifndef Renderer_hh
+#define Renderer_hh
+
+
+#include "Polygon.hh"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+using namespace std;
+
+
+/* The Renderer class draws polygons (cfc. class Polygon) into PNG images in
+ * the background: jobs are queued with a copy of their polygons and a pool
+ * of worker threads renders and encodes them, so the caller does not wait.
+ * Each job belongs to a client, which only waits for its own jobs.
+*/
+
+class Renderer {
+
+    public:
+
+    /* Timing of a finished job, in milliseconds. */
+    struct Job {
+        int id;
+        string image;
+        // Time spent in the queue.
+        double queued;
+        // Time spent rendering and encoding the image.
+        double rendering;
+    };
+
+    /* Constructor:
+       Creates a renderer with "threads" workers (0 means as many as the
+       hardware supports). Workers are started by the first job. */
+    Renderer(int threads = 0);
+
+    /* Destructor:
+       Finishes all the queued jobs. */
+    ~Renderer();
+
+    /* Queues a job of the given client that draws the polygons into the
+       given image file and returns its identifier, or -1 if the polygons
+       cannot be drawn (cfc. render()). */
+    int submit(int client, const string& image, const vector <Polygon>& polygons);
+
+    /* Waits for all the jobs of the client and returns the timing of its
+       jobs finished since the last call, in order of submission. */
+    vector <Job> wait(int client);
+
+    /* Draws the polygons into the given image file (of size×size pixels),
+       scaled to fit their bounding box. Returns false, without writing the
+       file, if there are no polygons or some of them is empty. */
+    static bool render(const string& image, const vector <Polygon>& polygons, int size = 500);
+
+    private:
+
+    using Clock = chrono::steady_clock;
+
+    /* A queued job. */
+    struct Task {
+        int id;
+        int client;
+        string image;
+        vector <Polygon> polygons;
+        Clock::time_point submitted;
+    };
+
+    /* Renders queued jobs until the renderer is destroyed. */
+    void work();
+
+    /* Number of worker threads. */
+    int threads;
+
+    /* Identifier of the next job. */
+    int next;
+
+
+    /* Whether the workers have to stop when the queue is empty. */
+    bool stop;
+
+    /* Queued jobs. */
+    deque <Task> queue;
+
+    /* Jobs of a client. */
+    struct Client {
+        // Number of jobs queued or being rendered.
+        int pending = 0;
+        // Timing of the finished jobs not reported yet.
+        vector <Job> finished;
+    };
+
+    /* Clients with jobs not reported yet. */
+    map <int, Client> clients;
+
+    /* Worker threads. */
+    vector <thread> workers;
+
+    /* Protects all the fields above. */
+    mutex lock;
+
+    /* Signals new jobs to the workers. */
+    condition_variable queued;
+
+    /* Signals finished jobs to wait(). */
+    condition_variable idle;
+
+};
+
+
+#endif
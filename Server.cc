@@ -0,0 +1,127 @@
+#include "Server.hh"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+/* Maximum length of a command line, so a client that never ends its line
+   cannot take all the memory. */
+static const size_t max_line = 1 << 24;
+
+
+/* Sends all the bytes of s to the socket fd. */
+static bool send_all(int fd, const string& s) {
+    size_t done = 0;
+    while (done < s.size()) {
+        ssize_t k = send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+        if (k < 0 and errno == EINTR) continue;
+        if (k <= 0) return false;
+        done += k;
+    }
+    return true;
+}
+
+
+/* Runs a session: executes the lines received from fd until it is closed,
+   with its own modes and pending expressions. */
+static void session(Calculator& calc, int fd) {
+    Session state;
+    // Received bytes not answered yet, of which the first "scanned" ones
+    // have no end of line.
+    string pending;
+    size_t scanned = 0;
+    char buffer[1 << 16];
+    bool open = true;
+    while (open) {
+        ssize_t k = recv(fd, buffer, sizeof buffer, 0);
+        if (k < 0 and errno == EINTR) continue;
+        if (k <= 0) break;
+        pending.append(buffer, k);
+        // Answers all the complete lines at once.
+        ostringstream out;
+        out.setf(ios::fixed);
+        out.precision(3);
+        size_t begin = 0, from = scanned, end;
+        while ((end = pending.find('\n', from)) != string::npos) {
+            string line = pending.substr(begin, end - begin);
+            if (not line.empty() and line.back() == '\r') line.pop_back();
+            execute(calc, state, line, out);
+            out << '\n';
+            begin = from = end + 1;
+        }
+        pending.erase(0, begin);
+        scanned = pending.size();
+        if (pending.size() > max_line) {
+            out << "error: line too long\n";
+            pending.clear();
+            open = false;
+        }
+        if (not send_all(fd, out.str())) open = false;
+    }
+    // A last line without end of line is also executed.
+    if (open and not pending.empty()) {
+        ostringstream out;
+        out.setf(ios::fixed);
+        out.precision(3);
+        execute(calc, state, pending, out);
+        out << '\n';
+        send_all(fd, out.str());
+    }
+    finish(calc, state);
+    close(fd);
+}
+
+
+int serve(Calculator& calc, const string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) {
+        cerr << "error: socket path too long" << endl;
+        return -1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        cerr << "error: " << strerror(errno) << endl;
+        return -1;
+    }
+    // Only an old socket is removed, never another kind of file.
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (not S_ISSOCK(info.st_mode)) {
+            cerr << "error: " << path << " exists and is not a socket" << endl;
+            close(fd);
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+    if (bind(fd, (sockaddr*)&addr, sizeof addr) < 0 or listen(fd, 64) < 0) {
+        cerr << "error: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    while (true) {
+        int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR or errno == ECONNABORTED) continue;
+            cerr << "error: " << strerror(errno) << endl;
+            // Out of descriptors (or another lasting error): waits for some
+            // session to close instead of retrying at once.
+            this_thread::sleep_for(chrono::milliseconds(100));
+            continue;
+        }
+        thread(session, ref(calc), client).detach();
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef Server_hh
+#define Server_hh
+
+
+#include "Calculator.hh"
+
+#include <string>
+using namespace std;
+
+
+/* Serves the calculator (cfc. struct Calculator) on a Unix domain socket
+ * bound to path. Each connection is a session that sends command lines and
+ * receives one answer line per command, as in the standard input mode.
+ * Sessions run concurrently on their own threads and share the polygons,
+ * but each one has its own modes (cfc. struct Session). A session whose
+ * line grows too long is closed. An old socket at path is replaced, but
+ * any other file is kept. Only returns (with -1) if the socket cannot be
+ * created. */
+int serve(Calculator& calc, const string& path);
+
+
+#endif
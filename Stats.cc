@@ -0,0 +1,348 @@
+#include "Stats.hh"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+
+/* Number of buckets of a latency histogram: four per power of two. */
+static const int buckets = 256;
+
+/* Maximum number of spans kept by each thread. */
+static const size_t max_spans = 1 << 20;
+
+
+/* Statistics of an operation. */
+struct Counter {
+    long long calls = 0, total = 0, max = 0, vertices = 0, bytes = 0;
+    long long histogram[buckets] = {};
+};
+
+
+/* A recorded call. */
+struct Event {
+    string name;
+    int thread;
+    long long start, duration, vertices, bytes;
+};
+
+
+/* Statistics and spans of a thread. */
+struct Table {
+    int thread;
+    mutex lock;
+    unordered_map <string, Counter> counters;
+    vector <Event> events;
+};
+
+
+/* Adds the statistics of b to a. */
+static void merge(Counter& a, const Counter& b) {
+    a.calls += b.calls;
+    a.total += b.total;
+    a.max = max(a.max, b.max);
+    a.vertices += b.vertices;
+    a.bytes += b.bytes;
+    for (int i = 0; i < buckets; ++i) a.histogram[i] += b.histogram[i];
+}
+
+
+/* Tables of the running threads that recorded something, and the merged
+   table of the finished ones. */
+static mutex tables_lock;
+static vector <Table*> tables;
+static Table retired;
+static int threads = 0;
+
+
+/* Owner of the table of a thread, which merges it into the retired table
+   when the thread finishes. */
+struct Owner {
+    Table* table = nullptr;
+
+    ~Owner() {
+        if (not table) return;
+        lock_guard <mutex> guard(tables_lock);
+        tables.erase(find(tables.begin(), tables.end(), table));
+        for (const auto& e : table->counters) merge(retired.counters[e.first], e.second);
+        for (Event& e : table->events) retired.events.push_back(move(e));
+        delete table;
+    }
+};
+
+/* Table of this thread. */
+static thread_local Owner mine;
+
+/* Bytes allocated by this thread while recording (cfc. STATS_ALLOC). */
+static thread_local long long bytes_allocated = 0;
+
+/* Start of the program. */
+static const chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+
+
+atomic <bool> Stats::on(false), Stats::trace_on(false);
+
+
+/* Returns the bucket of a latency of v nanoseconds. */
+static int bucket(long long v) {
+    if (v < 4) return v < 0 ? 0 : v;
+    int e = 63 - __builtin_clzll(v);
+    return 4*(e - 1) + ((v >> (e - 2)) & 3);
+}
+
+
+/* Returns the largest latency (in nanoseconds) of bucket b. */
+static long long bucket_top(int b) {
+    if (b < 4) return b;
+    int e = b/4 + 1;
+    return ((5LL + b%4) << (e - 2)) - 1;
+}
+
+
+/* Returns the latency (in nanoseconds) below which there are a fraction q
+   of the calls. */
+static long long percentile(const Counter& c, double q) {
+    long long seen = 0;
+    for (int b = 0; b < buckets; ++b) {
+        seen += c.histogram[b];
+        if (seen >= q*c.calls) return min(bucket_top(b), c.max);
+    }
+    return c.max;
+}
+
+
+/* Returns the table of this thread. */
+static Table& table() {
+    if (not mine.table) {
+        mine.table = new Table();
+        lock_guard <mutex> guard(tables_lock);
+        mine.table->thread = threads++;
+        tables.push_back(mine.table);
+    }
+    return *mine.table;
+}
+
+
+/* Starts recording statistics, and also the spans of the calls if
+"trace" is true. */
+void Stats::enable(bool trace) {
+    trace_on = trace;
+    on = true;
+}
+
+
+/* Stops recording statistics and spans. */
+void Stats::disable() {
+    on = false;
+    trace_on = false;
+}
+
+
+/* Removes all the statistics and spans recorded so far. */
+void Stats::reset() {
+    lock_guard <mutex> guard(tables_lock);
+    retired.counters.clear();
+    retired.events.clear();
+    for (Table* t : tables) {
+        lock_guard <mutex> guard(t->lock);
+        t->counters.clear();
+        t->events.clear();
+    }
+}
+
+
+/* Returns the statistics of every operation, merged over all the threads. */
+static map <string, Counter> merged() {
+    map <string, Counter> all;
+    lock_guard <mutex> guard(tables_lock);
+    for (const auto& e : retired.counters) merge(all[e.first], e.second);
+    for (Table* t : tables) {
+        lock_guard <mutex> guard(t->lock);
+        for (const auto& e : t->counters) merge(all[e.first], e.second);
+    }
+    return all;
+}
+
+
+/* Prints the statistics of every operation (in a single line). */
+void Stats::print(ostream& out) {
+    map <string, Counter> all = merged();
+    if (all.empty()) {
+        out << (enabled() ? "no calls" : "stats are off");
+        return;
+    }
+    // Times are printed in microseconds, down to the nanosecond.
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out.setf(ios::fixed, ios::floatfield);
+    out.precision(3);
+    bool first = true;
+    for (const auto& e : all) {
+        const Counter& c = e.second;
+        if (not first) out << "; ";
+        first = false;
+        out << e.first << " calls=" << c.calls << " total=" << c.total/1e3
+            << " mean=" << c.total/1e3/c.calls << " p50=" << percentile(c, 0.5)/1e3
+            << " p99=" << percentile(c, 0.99)/1e3 << " max=" << c.max/1e3
+            << " vertices=" << c.vertices << " bytes=" << c.bytes;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+
+/* Prints the latency histogram of an operation (in a single line): the
+   number of calls of each non-empty bucket, after the largest latency of
+   the bucket in microseconds. Returns false if the operation has no calls. */
+bool Stats::histogram(const string& name, ostream& out) {
+    map <string, Counter> all = merged();
+    if (not all.count(name)) return false;
+    const Counter& c = all[name];
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out.setf(ios::fixed, ios::floatfield);
+    out.precision(3);
+    out << name;
+    for (int b = 0; b < buckets; ++b) {
+        if (c.histogram[b] > 0) out << ' ' << bucket_top(b)/1e3 << ':' << c.histogram[b];
+    }
+    out.flags(flags);
+    out.precision(precision);
+    return true;
+}
+
+
+/* Writes a string as a JSON string. */
+static void json(ostream& out, const string& s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' or c == '\\') out << '\\' << c;
+        else if ((unsigned char)c < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+
+/* Writes the recorded spans to a file in the Chrome trace format.
+Returns false if the file cannot be written. */
+bool Stats::save(const string& path) {
+    ofstream file(path);
+    if (not file) return false;
+    file.setf(ios::fixed);
+    file.precision(3);
+    file << "{\"traceEvents\": [";
+    bool first = true;
+    auto write = [&](const vector <Event>& events) {
+        for (const Event& e : events) {
+            file << (first ? "\n" : ",\n");
+            first = false;
+            // Times are in microseconds.
+            file << "{\"name\": ";
+            json(file, e.name);
+            file << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.thread
+                 << ", \"ts\": " << e.start/1e3 << ", \"dur\": " << e.duration/1e3
+                 << ", \"args\": {\"vertices\": " << e.vertices << ", \"bytes\": " << e.bytes << "}}";
+        }
+    };
+    lock_guard <mutex> guard(tables_lock);
+    write(retired.events);
+    for (Table* t : tables) {
+        lock_guard <mutex> guard(t->lock);
+        write(t->events);
+    }
+    file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    return bool(file);
+}
+
+
+/* Records a call to the operation "name". Times are in nanoseconds. */
+void Stats::record(const string& name, long long start, long long duration,
+                   long long vertices, long long bytes) {
+    Table& t = table();
+    lock_guard <mutex> guard(t.lock);
+    Counter& c = t.counters[name];
+    ++c.calls;
+    c.total += duration;
+    c.max = max(c.max, duration);
+    c.vertices += vertices;
+    c.bytes += bytes;
+    ++c.histogram[bucket(duration)];
+    if (tracing() and t.events.size() < max_spans) {
+        t.events.push_back({name, t.thread, start, duration, vertices, bytes});
+    }
+}
+
+
+/* Returns the nanoseconds since the program started. */
+long long Stats::now() {
+    return chrono::duration_cast <chrono::nanoseconds>(chrono::steady_clock::now() - origin).count();
+}
+
+
+/* Returns the bytes allocated by this thread while recording, which are
+   only counted when compiled with STATS_ALLOC. */
+long long Stats::allocated() {
+    return bytes_allocated;
+}
+
+
+void Span::start(long long v) {
+    vertices = v;
+    bytes = Stats::allocated();
+    begin = Stats::now();
+}
+
+
+void Span::stop() {
+    long long end = Stats::now();
+    long long used = Stats::allocated() - bytes;
+    Stats::record(name ? string(name) : label, begin, end - begin, vertices, used);
+}
+
+
+/* When compiled with STATS_ALLOC, the global allocation functions count
+   the bytes allocated by each thread while the statistics are enabled.
+   The deallocation function is not inlined, so the compiler does not pair
+   its free() with a new. */
+
+#ifdef STATS_ALLOC
+
+void* operator new(size_t size) {
+    if (Stats::enabled()) bytes_allocated += size;
+    void* p = malloc(size ? size : 1);
+    if (not p) throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+#endif
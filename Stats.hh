@@ -0,0 +1,133 @@
+#ifndef Stats_hh
+#define Stats_hh
+
+
+#include <string>
+#include <ostream>
+#include <atomic>
+#include <chrono>
+using namespace std;
+
+
+/* The Stats class collects, for each command and each instrumented operation
+ * of class Polygon, its number of calls, a histogram of its latencies, and the
+ * vertices and bytes of memory it processed. Optionally, every call is also
+ * kept as a span to be exported in the Chrome trace format. Each thread keeps
+ * its own statistics, so recording needs no shared lock. While disabled,
+ * a span (cfc. class Span) costs a single test of a flag. Bytes are only
+ * counted when compiled with STATS_ALLOC, which replaces the global
+ * operator new and delete.
+*/
+
+class Stats {
+
+    public:
+
+    /* Starts recording statistics, and also the spans of the calls if
+       "trace" is true. */
+    static void enable(bool trace = false);
+
+    /* Stops recording statistics and spans. */
+    static void disable();
+
+    /* Tells whether statistics are being recorded. */
+    static bool enabled() {
+        return on.load(memory_order_relaxed);
+    }
+
+    /* Tells whether spans are being recorded. */
+    static bool tracing() {
+        return trace_on.load(memory_order_relaxed);
+    }
+
+    /* Removes all the statistics and spans recorded so far. */
+    static void reset();
+
+    /* Prints the statistics of every operation (in a single line). */
+    static void print(ostream& out);
+
+    /* Prints the latency histogram of an operation (in a single line): the
+       number of calls of each non-empty bucket, after the largest latency of
+       the bucket in microseconds. Returns false if the operation has no calls. */
+    static bool histogram(const string& name, ostream& out);
+
+    /* Writes the recorded spans to a file in the Chrome trace format.
+       Returns false if the file cannot be written. */
+    static bool save(const string& path);
+
+    /* Records a call to the operation "name". Times are in nanoseconds. */
+    static void record(const string& name, long long start, long long duration,
+                       long long vertices, long long bytes);
+
+    /* Returns the nanoseconds since the program started. */
+    static long long now();
+
+    /* Returns the bytes allocated by this thread while recording, which are
+       only counted when compiled with STATS_ALLOC. */
+    static long long allocated();
+
+    private:
+
+    /* Whether statistics and spans are being recorded. */
+    static atomic <bool> on, trace_on;
+
+};
+
+
+/* A Span measures the call of an operation, from its construction to its
+ * destruction, and records it in the statistics (cfc. class Stats) if they
+ * are enabled when it is created.
+*/
+
+class Span {
+
+    public:
+
+    /* Constructor:
+       Starts measuring the operation "name", which processes the given
+       number of vertices. */
+    Span(const char* name, long long vertices = 0)
+    :     name(name), active(Stats::enabled()) {
+        if (active) start(vertices);
+    }
+
+    /* Constructor:
+       Same as above, for a name that is not a literal. */
+    Span(const string& name, long long vertices = 0)
+    :     name(nullptr), active(Stats::enabled()) {
+        if (active) {
+            label = name;
+            start(vertices);
+        }
+    }
+
+    /* Destructor:
+       Records the operation. */
+    ~Span() {
+        if (active) stop();
+    }
+
+    /* Adds vertices to the ones processed by the operation. */
+    void add(long long v) {
+        vertices += v;
+    }
+
+    private:
+
+    void start(long long v);
+    void stop();
+
+    /* Name of the operation (label if it is null). */
+    const char* name;
+    string label;
+
+    /* Whether the operation is being measured. */
+    bool active;
+
+    /* Vertices processed, and time and bytes allocated when it started. */
+    long long vertices = 0, begin = 0, bytes = 0;
+
+};
+
+
+#endif
@@ -0,0 +1,220 @@
+#include "Calculator.hh"
+#include "Point.hh"
+#include "Polygon.hh"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+
+using vp = vector <Point>;
+using Clock = chrono::steady_clock;
+
+
+/* Keeps the results of the timed operations alive. */
+volatile double sink;
+
+
+/* Returns n random points uniformly distributed in a 1000×1000 square. */
+vp random_points(int n, mt19937_64& gen) {
+    uniform_real_distribution <double> U(0, 1000);
+    vp points(n);
+    for (Point& p : points) p = Point(U(gen), U(gen));
+    return points;
+}
+
+
+/* Returns n random points on a circle of radius 500, so all of them
+   are vertices of their convex hull. */
+vp circular_points(int n, mt19937_64& gen) {
+    uniform_real_distribution <double> U(0, 2*M_PI);
+    vp points(n);
+    for (Point& p : points) {
+        double a = U(gen);
+        p = Point(500 + 500*cos(a), 500 + 500*sin(a));
+    }
+    return points;
+}
+
+
+/* Returns n random points at most 1e-6 away from a segment of length 1000,
+   which give many nearly aligned vertices. */
+vp collinear_points(int n, mt19937_64& gen) {
+    uniform_real_distribution <double> U(0, 1000), E(-1e-6, 1e-6);
+    vp points(n);
+    for (Point& p : points) {
+        double t = U(gen);
+        p = Point(t, 0.5*t + E(gen));
+    }
+    return points;
+}
+
+
+/* Returns the seconds per call of f, repeating it for at least "budget"
+   seconds (but at least once), and stores the number of calls in reps. */
+double measure(const function <void()>& f, int& reps, double budget) {
+    reps = 0;
+    double total = 0;
+    do {
+        Clock::time_point start = Clock::now();
+        f();
+        total += chrono::duration <double> (Clock::now() - start).count();
+        ++reps;
+    } while (total < budget);
+    return total/reps;
+}
+
+
+/* Returns the seconds that a call on an input of the given size is expected
+   to take, from the times of the calls on the last two (smaller) inputs,
+   assuming a cost that grows as size^k, with 1 <= k <= 3. */
+double predict(const vector <pair <double, double>>& times, double size) {
+    int m = times.size();
+    if (m < 2) return 0;
+    double s1 = times[m - 2].first, t1 = times[m - 2].second;
+    double s2 = times[m - 1].first, t2 = times[m - 1].second;
+    if (size <= s2) return t2;
+    double k = 1;
+    if (s2 > s1 and t1 > 0 and t2 > t1) k = log(t2/t1)/log(s2/s1);
+    k = min(3.0, max(1.0, k));
+    return t2*pow(size/s2, k);
+}
+
+
+/* Returns a script of commands over "polygons" random polygons. */
+string script(int polygons, mt19937_64& gen) {
+    uniform_real_distribution <double> U(0, 100);
+    uniform_int_distribution <int> N(3, 32), I(0, polygons - 1);
+    ostringstream s;
+    for (int i = 0; i < polygons; ++i) {
+        s << "polygon p" << i;
+        for (int k = N(gen); k > 0; --k) s << ' ' << U(gen) << ' ' << U(gen);
+        s << '\n';
+    }
+    for (int i = 0; i < polygons; ++i) {
+        int j = I(gen);
+        s << "area p" << i << '\n';
+        s << "perimeter p" << i << '\n';
+        s << "centroid p" << i << '\n';
+        s << "inside p" << i << " p" << j << '\n';
+        s << "intersection t p" << i << " p" << j << '\n';
+        s << "union u p" << i << " p" << j << '\n';
+        s << "bbox b p" << i << " p" << j << '\n';
+        s << "vertices t\n";
+    }
+    s << "area *\n";
+    return s.str();
+}
+
+
+/* Times the Polygon operations on the generated point sets, and the command
+   loop on a generated script, and writes the results as JSON, along with
+   the commit given in the COMMIT environment variable. Operations expected
+   to need more than "limit" seconds per call are skipped.
+   Usage: bench.exe [max points] [seed] [seconds per measure] [limit] */
+int main (int argc, char* argv[]) {
+    long long max_points = argc > 1 ? atoll(argv[1]) : 10000000;
+    unsigned seed = argc > 2 ? atoi(argv[2]) : 1;
+    double budget = argc > 3 ? atof(argv[3]) : 0.2;
+    double limit = argc > 4 ? atof(argv[4]) : 60;
+    const char* commit = getenv("COMMIT");
+
+    struct Generator {
+        string name;
+        function <vp(int, mt19937_64&)> points;
+    };
+    vector <Generator> generators = {
+        {"random", random_points},
+        {"circular", circular_points},
+        {"collinear", collinear_points}
+    };
+
+    cout.precision(9);
+    cout << "{\n";
+    cout << "  \"commit\": \"" << (commit and *commit ? commit : "unknown") << "\",\n";
+    cout << "  \"seed\": " << seed << ",\n";
+    cout << "  \"date\": " << time(nullptr) << ",\n";
+    cout << "  \"results\": [";
+    bool first = true;
+    for (const Generator& g : generators) {
+        // Sizes and times of each operation, to skip the slow ones.
+        map <string, vector <pair <double, double>>> times;
+        for (long long n = 10; n <= max_points; n *= 10) {
+            mt19937_64 gen(seed);
+            vp A = g.points(n, gen);
+            vp B = g.points(n, gen);
+            // B is shifted so that both polygons overlap partially.
+            for (Point& p : B) p = Point(p.getX() + 100, p.getY() + 100);
+            Polygon P(A), Q(B);
+            Polygon Box = P.bbox();
+
+            // The cost of the constructor depends on the points, and the
+            // cost of the rest on the vertices.
+            double points = n, vertices = P.vertices() + Q.vertices();
+            struct Operation {
+                string name;
+                double size;
+                function <void()> run;
+            };
+            vector <Operation> operations = {
+                {"construct", points, [&] { sink = Polygon(A).vertices(); }},
+                {"area", vertices, [&] { sink = P.area(); }},
+                {"perimeter", vertices, [&] { sink = P.perimeter(); }},
+                {"intersection", vertices, [&] { sink = P.intersection(Q).vertices(); }},
+                {"union", vertices, [&] { sink = P.union_(Q).vertices(); }},
+                {"inside", vertices, [&] { sink = P.inside(Box); }},
+                {"bbox", vertices, [&] { sink = P.bbox().vertices(); }}
+            };
+            for (const Operation& op : operations) {
+                cout << (first ? "\n" : ",\n");
+                first = false;
+                cout << "    {\"operation\": \"" << op.name << "\", \"generator\": \"" << g.name
+                     << "\", \"points\": " << n << ", \"vertices\": " << P.vertices();
+                double expected = predict(times[op.name], op.size);
+                if (expected > limit) {
+                    cout << ", \"skipped\": true, \"expected\": " << expected << "}";
+                    continue;
+                }
+                int reps;
+                double seconds = measure(op.run, reps, budget);
+                times[op.name].push_back({op.size, seconds});
+                cout << ", \"repetitions\": " << reps << ", \"seconds\": " << seconds << "}";
+            }
+        }
+    }
+    cout << "\n  ],\n";
+
+    // Whole scripts through the command loop.
+    mt19937_64 gen(seed);
+    string commands = script(10000, gen);
+    int lines = 0;
+    for (char c : commands) lines += c == '\n';
+    int reps;
+    double seconds = measure([&] {
+        Calculator calc;
+        Session session;
+        istringstream in(commands);
+        ostringstream out;
+        out.setf(ios::fixed);
+        out.precision(3);
+        string s;
+        while (getline(in, s)) {
+            execute(calc, session, s, out);
+            out << '\n';
+        }
+        sink = out.str().size();
+    }, reps, budget);
+    cout << "  \"script\": {\"commands\": " << lines << ", \"repetitions\": " << reps
+         << ", \"seconds\": " << seconds << ", \"commands_per_second\": " << lines/seconds << "}\n";
+    cout << "}" << endl;
+}
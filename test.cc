@@ -0,0 +1,430 @@
+#include "Point.hh"
+#include "Polygon.hh"
+#include "PolygonSet.hh"
+#include "Calculator.hh"
+#include "Join.hh"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <map>
+
+using namespace std;
+
+using vp = vector <Point>;
+
+
+/* Number of failed checks. */
+int failures = 0;
+
+
+/* Reports a failed check if cond is false. */
+void check(bool cond, const string& what) {
+    if (not cond) {
+        ++failures;
+        cout << "FAILED: " << what << endl;
+    }
+}
+
+
+/* Returns the distance from point P to the segment ab. */
+double segment_distance(const Point& P, const Point& a, const Point& b) {
+    double dx = b.getX() - a.getX(), dy = b.getY() - a.getY();
+    double l2 = dx*dx + dy*dy;
+    double t = 0;
+    if (l2 > 0) t = ((P.getX() - a.getX())*dx + (P.getY() - a.getY())*dy)/l2;
+    t = max(0.0, min(1.0, t));
+    return P.distance(Point(a.getX() + t*dx, a.getY() + t*dy));
+}
+
+
+/* Returns the distance from point P to the convex polygon Q (0 inside). */
+double distance(const Point& P, const Polygon& Q) {
+    const vp& q = Q.getPoints();
+    int n = q.size();
+    if (n == 1) return P.distance(q[0]);
+    bool inside = n > 2;
+    double d = 1e300;
+    for (int i = 0; i < n; ++i) {
+        const Point& a = q[i];
+        const Point& b = q[(i + 1)%n];
+        d = min(d, segment_distance(P, a, b));
+        // The vertices are in clockwise order.
+        double cross = (b.getX() - a.getX())*(P.getY() - a.getY()) - (b.getY() - a.getY())*(P.getX() - a.getX());
+        if (cross > 0) inside = false;
+    }
+    return inside ? 0 : d;
+}
+
+
+/* Returns the largest distance from a point of P to the convex polygon Q.
+   The distance to a convex set is convex, so its maximum is at a vertex. */
+double excess(const Polygon& P, const Polygon& Q) {
+    double h = 0;
+    for (const Point& p : P.getPoints()) h = max(h, distance(p, Q));
+    return h;
+}
+
+
+/* Returns the Hausdorff distance between the convex polygons P and Q. */
+double hausdorff(const Polygon& P, const Polygon& Q) {
+    return max(excess(P, Q), excess(Q, P));
+}
+
+
+/* Returns a random convex polygon: random points on an ellipse with the given
+   radii, rotated by a random angle. */
+Polygon ellipse(int n, double rx, double ry, mt19937_64& gen) {
+    uniform_real_distribution <double> U(0, 2*M_PI);
+    double r = U(gen);
+    vp points;
+    for (int i = 0; i < n; ++i) {
+        double a = U(gen);
+        double x = rx*cos(a), y = ry*sin(a);
+        points.push_back(Point(x*cos(r) - y*sin(r), x*sin(r) + y*cos(r)));
+    }
+    return Polygon(points);
+}
+
+
+/* Tells whether three edge lines of the convex polygon P make a triangle
+   that contains it, trying all of them. */
+bool outer_triangle(const Polygon& P) {
+    const vp& p = P.getPoints();
+    int n = p.size();
+    // Returns the point where the lines of edges i and j meet.
+    auto meet = [&](int i, int j, Point& X) {
+        const Point& a = p[i];
+        const Point& c = p[j];
+        double dx = p[(i+1)%n].getX() - a.getX(), dy = p[(i+1)%n].getY() - a.getY();
+        double ex = p[(j+1)%n].getX() - c.getX(), ey = p[(j+1)%n].getY() - c.getY();
+        double cross = dx*ey - dy*ex;
+        if (abs(cross) < 1e-12) return false;
+        double t = ((c.getX() - a.getX())*ey - (c.getY() - a.getY())*ex)/cross;
+        X = Point(a.getX() + t*dx, a.getY() + t*dy);
+        return true;
+    };
+    for (int i = 0; i < n; ++i) {
+        for (int j = i + 1; j < n; ++j) {
+            for (int l = j + 1; l < n; ++l) {
+                Point X, Y, Z;
+                if (not meet(i, j, X) or not meet(j, l, Y) or not meet(l, i, Z)) continue;
+                if (excess(P, Polygon(vp{X, Y, Z})) <= 1e-7) return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+/* Checks that the simplified polygons are within the tolerance of the
+   original ones, and on the right side. */
+void test_simplify() {
+    // Thin ellipse whose tip was dropped by the inner approximation.
+    vp thin;
+    for (int i = 0; i < 14; ++i) {
+        double a = 2*M_PI*i/14 + 0.1;
+        thin.push_back(Point(300*cos(a), 3*sin(a)));
+    }
+    Polygon E(thin);
+    Polygon S = E.simplify(4.71666, Polygon::inner);
+    check(hausdorff(E, S) <= 4.71666 + 1e-9, "simplify inner of a thin ellipse");
+
+    mt19937_64 gen(1);
+    uniform_real_distribution <double> R(1, 500), T(0.001, 1);
+    uniform_int_distribution <int> N(4, 200);
+    for (int it = 0; it < 2000; ++it) {
+        double rx = R(gen), ry = R(gen);
+        Polygon P = ellipse(N(gen), rx, ry, gen);
+        if (P.vertices() < 4) continue;
+        double tol = T(gen)*max(rx, ry);
+        for (Polygon::Approximation side : {Polygon::inner, Polygon::outer}) {
+            string name = side == Polygon::inner ? "inner" : "outer";
+            Polygon S = P.simplify(tol, side);
+            check(hausdorff(P, S) <= tol*(1 + 1e-9) + 1e-9, "simplify " + name + " within tolerance");
+            check(S.vertices() <= P.vertices(), "simplify " + name + " does not add vertices");
+            // Rounding errors are allowed.
+            double eps = 1e-9*max(rx, ry);
+            if (side == Polygon::inner) check(excess(S, P) <= eps, "simplify inner inside");
+            else check(excess(P, S) <= eps, "simplify outer contains");
+            int k = 3 + it%5;
+            Polygon D = P.simplifyVertices(k, side);
+            check(D.vertices() <= max(k, 3), "simplifyVertices " + name + " vertices");
+        }
+    }
+
+    // A square has no outer triangle made of its edge lines.
+    Polygon Q(vp{Point(0, 0), Point(0, 1), Point(1, 1), Point(1, 0)});
+    check(Q.simplifyVertices(3, Polygon::inner).vertices() == 3, "simplifyVertices inner of a square");
+    check(excess(Q, Q.simplifyVertices(3, Polygon::outer)) <= 1e-9, "simplifyVertices outer of a square contains it");
+
+    // Hulls of random points, whose edges are not as regular as the ones
+    // of an ellipse. Only outer triangles can be impossible, which is
+    // checked with all the triples of edges (of the smaller hulls).
+    uniform_real_distribution <double> U(0, 100);
+    uniform_int_distribution <int> M(5, 40);
+    for (int it = 0; it < 3000; ++it) {
+        vp points(it%6 == 0 ? M(gen)/2 : M(gen));
+        for (Point& p : points) p = Point(U(gen), U(gen));
+        Polygon P(points);
+        int k = 3 + it%6;
+        for (Polygon::Approximation side : {Polygon::inner, Polygon::outer}) {
+            string name = side == Polygon::inner ? "inner" : "outer";
+            Polygon D = P.simplifyVertices(k, side);
+            if (side == Polygon::inner or k > 3 or outer_triangle(P)) {
+                check(D.vertices() <= k, "simplifyVertices " + name + " vertices of a hull");
+            }
+            if (side == Polygon::inner) check(excess(D, P) <= 1e-9, "simplifyVertices inner of a hull inside");
+            else check(excess(P, D) <= 1e-9, "simplifyVertices outer of a hull contains it");
+        }
+    }
+}
+
+
+/* Checks the metrics of a PolygonSet against the ones of its polygons, for
+   sets of small and large polygons. */
+void test_polygonset() {
+    mt19937_64 gen(3);
+    uniform_real_distribution <double> U(-100, 100);
+    uniform_int_distribution <int> N(1, 20);
+    for (int it = 0; it < 100; ++it) {
+        vector <Polygon> pols;
+        PolygonSet S;
+        for (int k = 1 + it%13; k > 0; --k) {
+            vp points(N(gen));
+            for (Point& p : points) p = Point(U(gen), U(gen));
+            pols.push_back(Polygon(points));
+            S.add(pols.back());
+        }
+        vector <Point> centroids = S.centroids();
+        vector <double> xmin, ymin, xmax, ymax;
+        S.bboxes(xmin, ymin, xmax, ymax);
+        for (int k = 0; k < (int)pols.size(); ++k) {
+            Point G = pols[k].centroid();
+            check(abs(G.getX() - centroids[k].getX()) < 1e-9 and abs(G.getY() - centroids[k].getY()) < 1e-9,
+                  "PolygonSet centroid");
+            double x0 = HUGE_VAL, y0 = HUGE_VAL, x1 = -HUGE_VAL, y1 = -HUGE_VAL;
+            for (const Point& p : pols[k].getPoints()) {
+                x0 = min(x0, p.getX());
+                y0 = min(y0, p.getY());
+                x1 = max(x1, p.getX());
+                y1 = max(y1, p.getY());
+            }
+            check(x0 == xmin[k] and y0 == ymin[k] and x1 == xmax[k] and y1 == ymax[k], "PolygonSet bbox");
+        }
+    }
+}
+
+
+/* Returns the answers of the calculator to a script, one per line. */
+vector <string> run(const vector <string>& script) {
+    Calculator calc;
+    Session session;
+    vector <string> answers;
+    for (const string& line : script) {
+        ostringstream out;
+        out.setf(ios::fixed);
+        out.precision(3);
+        execute(calc, session, line, out);
+        answers.push_back(out.str());
+    }
+    return answers;
+}
+
+
+/* Checks that each tile of a polygon is its clip by the rectangle of its
+   cell, on random ellipses and grids (some cells outside the polygon). */
+void test_tiles() {
+    mt19937_64 gen(4);
+    uniform_int_distribution <int> N(3, 60), G(1, 6);
+    uniform_real_distribution <double> R(0.5, 10), X(-12, 0), W(0.3, 5);
+    for (int it = 0; it < 300; ++it) {
+        Polygon P = ellipse(N(gen), R(gen), R(gen), gen);
+        double x0 = X(gen), y0 = X(gen), w = W(gen), h = W(gen);
+        int cols = G(gen), rows = G(gen);
+        vector <Polygon> grid = P.tiles(x0, y0, w, h, cols, rows);
+        check((int)grid.size() == cols*rows, "tiles number of tiles");
+        for (int j = 0; j < rows; ++j) {
+            for (int i = 0; i < cols; ++i) {
+                const Polygon& T = grid[j*cols + i];
+                Polygon C = P.clipRect(x0 + i*w, y0 + j*h, x0 + (i + 1)*w, y0 + (j + 1)*h);
+                check(abs(T.area() - C.area()) <= 1e-9*(1 + P.area()), "tiles area of a tile");
+                if (T.vertices() > 0 and C.vertices() > 0) check(hausdorff(T, C) <= 1e-9*(1 + P.width() + P.height()), "tiles shape of a tile");
+            }
+        }
+    }
+}
+
+
+/* Checks the areas written by join against the ones of the intersections,
+   on random ellipses and on polygons with vertical edges (rectangles and
+   integer hulls), whose areas need more than 6 digits. */
+void test_join() {
+    mt19937_64 gen(5);
+    uniform_int_distribution <int> N(3, 30), I(0, 40);
+    uniform_real_distribution <double> R(100, 3000), X(-1000, 1000);
+    vector <pair <string, Polygon>> A, B;
+    for (int i = 0; i < 60; ++i) {
+        vector <pair <string, Polygon>>& S = i%2 ? B : A;
+        string id = "p" + to_string(i);
+        if (i%3 == 0) {
+            Polygon E = ellipse(N(gen), R(gen), R(gen), gen);
+            vp points;
+            double dx = X(gen), dy = X(gen);
+            for (const Point& p : E.getPoints()) points.push_back(Point(p.getX() + dx + 1/3.0, p.getY() + dy));
+            S.push_back({id, Polygon(points)});
+        } else if (i%3 == 1) {
+            double x = X(gen), y = X(gen);
+            S.push_back({id, Polygon(vp{Point(x, y), Point(x + R(gen)/7, y), Point(x, y + R(gen)), Point(x + 1/3.0, y + 1000)}).bbox()});
+        } else {
+            vp points;
+            for (int k = 0; k < 8; ++k) points.push_back(Point(I(gen)*40.0 - 800, I(gen)*40.0 - 800));
+            points.push_back(Point(points[0].getX(), points[1].getY()));
+            S.push_back({id, Polygon(points)});
+        }
+    }
+    ostringstream out;
+    join(A, B, out, 3);
+    map <pair <string, string>, double> rows;
+    istringstream iss(out.str());
+    string a, b;
+    double area;
+    while (iss >> a >> b >> area) rows[{a, b}] = area;
+    int overlaps = 0;
+    for (const auto& p : A) {
+        for (const auto& q : B) {
+            double expected = p.second.intersection(q.second).area();
+            auto it = rows.find({p.first, q.first});
+            double got = it == rows.end() ? 0 : it->second;
+            if (expected > 0) ++overlaps;
+            check(abs(got - expected) <= 1e-9*max(1.0, expected), "join area of " + p.first + " " + q.first);
+        }
+    }
+    check(overlaps > 100, "join enough overlaps");
+}
+
+
+/* Checks that random scripts give the same answers in lazy mode as in the
+   normal mode, including commands that use polygons not named in their
+   line (tiles and the bulk * commands). */
+void test_lazy() {
+    mt19937_64 gen(2);
+    uniform_int_distribution <int> C(0, 10), N(3, 8), X(0, 10);
+    vector <string> names = {"p0", "p1", "p2", "p3", "t_0_0", "t_0_1", "t_1_0", "t_1_1"};
+    uniform_int_distribution <int> I(0, names.size() - 1);
+    auto name = [&] { return names[I(gen)]; };
+    // Distinct identifiers for a command, as the results of the baseline
+    // operations are wrong when the result is also an operand. The first
+    // two are among p0 to p3, which are always defined.
+    auto distinct = [&] {
+        vector <string> v(names);
+        shuffle(v.begin(), v.begin() + 4, gen);
+        shuffle(v.begin() + 2, v.end(), gen);
+        return v;
+    };
+    for (int it = 0; it < 200; ++it) {
+        vector <string> script;
+        for (int i = 0; i < 4; ++i) {
+            ostringstream s;
+            // All the polygons contain the square [4, 6] x [4, 6], and tiles
+            // keeps them whole in t_0_0, so no command gives an empty or
+            // degenerate polygon.
+            s << "polygon p" << i << " 4 4 4 6 6 6 6 4";
+            for (int k = N(gen); k > 0; --k) s << ' ' << X(gen) << ' ' << X(gen);
+            script.push_back(s.str());
+        }
+        for (int i = 0; i < 40; ++i) {
+            vector <string> v = distinct();
+            switch (C(gen)) {
+                case 0: script.push_back("intersection " + v[2] + ' ' + v[0] + ' ' + v[1]); break;
+                case 1: script.push_back("union " + v[2] + ' ' + v[0] + ' ' + v[1]); break;
+                case 2: script.push_back("intersection " + v[2] + ' ' + v[0]); break;
+                case 3: script.push_back("tiles t " + v[0] + " 0 0 20 20 2 2"); break;
+                case 4: script.push_back("area *"); break;
+                case 5: script.push_back("perimeter *"); break;
+                case 6: script.push_back("centroid *"); break;
+                case 7: script.push_back("print " + name()); break;
+                case 8: script.push_back("inside " + name() + ' ' + name()); break;
+                case 9: script.push_back("bbox " + v[2] + ' ' + v[0] + ' ' + v[1]); break;
+                default: script.push_back("area " + name());
+            }
+        }
+        script.push_back("list");
+        vector <string> eager = run(script);
+        script.insert(script.begin(), "lazy on");
+        vector <string> lazy = run(script);
+        lazy.erase(lazy.begin());
+        bool same = eager == lazy;
+        check(same, "lazy mode gives the same answers");
+        if (not same) {
+            for (int i = 0; i < (int)eager.size(); ++i) {
+                if (eager[i] != lazy[i]) {
+                    cout << script[i + 1] << ": " << eager[i] << " / " << lazy[i] << endl;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+/* Checks that the pending expressions of a session are not seen by the
+   others until they are evaluated, also with both sessions running at the
+   same time. */
+void test_sessions() {
+    Calculator calc;
+    Session A, B;
+    auto ask = [&](Session& session, const string& line) {
+        ostringstream out;
+        out.setf(ios::fixed);
+        out.precision(3);
+        execute(calc, session, line, out);
+        return out.str();
+    };
+    ask(A, "polygon p 0 0 3 0 0 3");
+    ask(A, "polygon q 1 1 4 1 1 4 -1 0");
+    ask(A, "lazy on");
+    check(ask(A, "intersection c p q") == "ok", "lazy intersection");
+    check(ask(B, "area c") == "error: undefined polygon identifier", "pending polygon not seen by other sessions");
+    check(ask(B, "list") == "p q ", "pending polygon not listed by other sessions");
+    check(ask(A, "list") == "c p q ", "pending polygon listed by its session");
+    string area = ask(A, "area c");
+    check(area == "3.100", "pending polygon evaluated");
+    check(ask(B, "area c") == area, "evaluated polygon seen by other sessions");
+
+    // B reads c while A keeps replacing it lazily.
+    ask(A, "lazy off");
+    bool wrong = false;
+    thread reader([&] {
+        Session R;
+        for (int i = 0; i < 2000; ++i) {
+            string a = ask(R, "area c");
+            if (a != area and a != "4.500") wrong = true;
+        }
+    });
+    Session W;
+    ask(W, "lazy on");
+    for (int i = 0; i < 2000; ++i) {
+        ask(W, i%2 ? "intersection c p q" : "union c p p");
+        ask(W, "area c");
+    }
+    reader.join();
+    check(not wrong, "other sessions only see evaluated polygons");
+}
+
+
+int main () {
+    test_simplify();
+    test_polygonset();
+    test_tiles();
+    test_join();
+    test_lazy();
+    test_sessions();
+    if (failures == 0) cout << "ok" << endl;
+    return failures > 0;
+}